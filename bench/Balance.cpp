@@ -0,0 +1,198 @@
+/*
+    Monte Carlo balance simulator. Every weapon fights every armour's
+    wearer against every enemy, many times over, to show how each
+    match tends to go: how often the player wins, and how much health
+    it costs them. Fights run through the same Combat arithmetic as
+    the game, a vector of them at a time (one to a lane), across
+    however many threads.
+
+    Weapons and armour only differ in a fight by their attack and
+    defence, so matches are made of those rather than of every item.
+
+    Usage: sludge_balance [--fights=N] [--threads=N] [--seed=N]
+                          [--attack_step=N] [--defence_step=N] [--csv=1]
+    Run from the build directory, as the game loads ../data/. Tables
+    show every attack_step-th attack and defence_step-th defence, or
+    with --csv=1, everything.
+*/
+
+#include "Combat.h"
+#include "Config.h"
+#include "Game.h"
+#include "Random.h"
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <set>
+#include <iomanip>
+
+// Fights run side by side, one to a lane
+#define LANES 8
+
+// Any longer and a fight's taken to be a stalemate (which an unarmed
+// player in good enough armour can get stuck in), counting as no win
+#define MAX_EXCHANGES 1000
+
+typedef float Floats __attribute__((vector_size(LANES * sizeof(float))));
+typedef int32_t Ints __attribute__((vector_size(LANES * sizeof(int32_t))));
+typedef uint64_t Bits __attribute__((vector_size(LANES * sizeof(uint64_t))));
+
+typedef std::chrono::steady_clock Clock;
+
+struct Match
+{
+    int attack;     // 0 for fighting empty-handed
+    int defence;
+    EnemyID enemy;
+
+    uint64_t wins = 0;
+    uint64_t healthLost = 0;    // Over every fight; losing one costs all of it
+};
+
+// Fights the match LANES times over, as Game::OnExchange() would
+static void Fight(Match& match, const uint64_t key)
+{
+    const Enemy& enemy = Game::Get().enemies[match.enemy];
+    const Floats attack = Floats{} + (float) match.attack;
+    const Floats defence = Floats{} + (float) match.defence;
+    const Floats damage = Floats{} + (float) enemy.damage;
+
+    Bits keys;
+    for (int lane = 0; lane < LANES; ++lane) keys[lane] = Random::Hash(key, lane);
+    uint64_t drawn = 0;
+
+    // As Random::NextFloat(), but a number for each lane
+    const auto Roll = [&]()
+    {
+        return __builtin_convertvector(Random::Draw(keys, drawn++) >> 40, Floats) * (1.0f / (1 << 24));
+    };
+
+    Ints playerHealth = Ints{} + MAX_PLAYER_HEALTH;
+    Ints enemyHealth = Ints{} + enemy.maxHealth;
+    Ints over = Combat::IsOver(playerHealth, enemyHealth);
+
+    // Lanes whose fight is over stay as they are until every lane's done
+    for (int exchange = 0; exchange < MAX_EXCHANGES; ++exchange)
+    {
+        bool done = true;
+        for (int lane = 0; lane < LANES; ++lane) done &= over[lane] != 0;
+        if (done) break;
+
+        // A blow each, with the player's first (so long as they've something to strike with)
+        for (const bool playersTurn : { true, false })
+        {
+            const Floats variation = Combat::GetVariation(Roll());
+
+            if (playersTurn && match.attack > 0)
+                enemyHealth = over ? enemyHealth : Combat::Wound(enemyHealth, Combat::GetAttackDamage(attack, variation));
+            else
+                playerHealth = over ? playerHealth : Combat::Wound(playerHealth, Combat::GetDefenceDamage(damage, defence, variation));
+
+            over = Combat::IsOver(playerHealth, enemyHealth);
+        }
+    }
+
+    for (int lane = 0; lane < LANES; ++lane)
+    {
+        if (playerHealth[lane] >= 0 && enemyHealth[lane] <= 0) match.wins++;
+        match.healthLost += MAX_PLAYER_HEALTH - std::max(playerHealth[lane], 0);
+    }
+}
+
+static void PrintTable(const std::vector<Match>& matches, const EnemyID enemy, const std::vector<int>& attacks,
+    const std::vector<int>& defences, const uint64_t fights, const bool winRate)
+{
+    const bool csv = Config::Get().GetInt("csv", 0) != 0;
+    const size_t attackStep = csv ? 1 : std::max(Config::Get().GetInt("attack_step", 5), 1);
+    const size_t defenceStep = csv ? 1 : std::max(Config::Get().GetInt("defence_step", 5), 1);
+
+    std::cout << enemy << ": " << Game::Get().enemies[enemy].name << ", "
+              << (winRate ? "win rate (%)" : "expected health lost")
+              << " by attack (down) and defence (across)" << std::endl;
+
+    std::cout << (csv ? "" : "      ");
+    for (size_t d = 0; d < defences.size(); d += defenceStep)
+    {
+        if (csv) std::cout << "," << defences[d];
+        else std::cout << std::setw(6) << defences[d];
+    }
+    std::cout << std::endl;
+
+    for (size_t a = 0; a < attacks.size(); a += attackStep)
+    {
+        if (csv) std::cout << attacks[a];
+        else std::cout << std::setw(6) << attacks[a];
+
+        for (size_t d = 0; d < defences.size(); d += defenceStep)
+        {
+            const Match& match = matches[(enemy * attacks.size() + a) * defences.size() + d];
+            const double value = winRate ? 100.0 * match.wins / fights : (double) match.healthLost / fights;
+
+            if (csv) std::cout << "," << value;
+            else std::cout << std::setw(6) << std::fixed << std::setprecision(1) << value;
+        }
+
+        std::cout << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    Config::Get().ParseArguments(argc, argv);
+    const int nThreads = Config::Get().GetInt("threads", std::thread::hardware_concurrency());
+    const uint64_t seed = Config::Get().GetInt("seed", 0);
+
+    // Rounded up to whole vectors of fights
+    const uint64_t nBatches = (std::max(Config::Get().GetInt("fights", 100000), 1) + LANES - 1) / LANES;
+    const uint64_t fights = nBatches * LANES;
+
+    // Every attack and defence there is, along with going without
+    const Game& game = Game::Get();
+    std::set<int> attackSet = { 0 };
+    std::set<int> defenceSet = { 0 };
+    for (const auto& list : game.weapons) for (const ItemID item : list) attackSet.insert(game.items[item].attack);
+    for (const auto& list : game.armours) for (const ItemID item : list) defenceSet.insert(game.items[item].defence);
+
+    const std::vector<int> attacks(attackSet.begin(), attackSet.end());
+    const std::vector<int> defences(defenceSet.begin(), defenceSet.end());
+
+    std::vector<Match> matches;
+    for (EnemyID enemy = 0; enemy < game.enemies.size(); ++enemy)
+        for (const int attack : attacks)
+            for (const int defence : defences)
+                matches.push_back({ attack, defence, enemy });
+
+    // Threads take whichever match is next
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+
+    const auto start = Clock::now();
+    for (int i = 0; i < std::max(nThreads, 1); ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            for (size_t m = next++; m < matches.size(); m = next++)
+                for (uint64_t batch = 0; batch < nBatches; ++batch)
+                    Fight(matches[m], Random::Hash(seed, m, batch));
+        });
+    }
+
+    for (auto& thread : threads) thread.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (EnemyID enemy = 0; enemy < game.enemies.size(); ++enemy)
+    {
+        PrintTable(matches, enemy, attacks, defences, fights, true);
+        PrintTable(matches, enemy, attacks, defences, fights, false);
+    }
+
+    const uint64_t total = fights * matches.size();
+    std::cout << matches.size() << " matches of " << fights << " fights each; " << total << " fights in "
+              << seconds << "s (" << std::setprecision(1) << total / seconds / 1e6 << "M fights/s over " << threads.size() << " threads)"
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+    Loopback benchmark comparing the network backends. Each backend
+    is run as a real server in a child process, then hammered with
+    command round-trips from client threads in this one.
+
+    Usage: sludge_netbench [--clients=N] [--commands=N] [--port=P]
+    Run from the build directory, as the server loads ../data/.
+*/
+
+#include "EventLoop.h"
+#include "Config.h"
+#include "Game.h"
+#include "Simulation.h"
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <signal.h>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result
+{
+    double seconds;
+    std::vector<double> latencies; // Microseconds
+};
+
+static int Connect(const int port)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    return fd;
+}
+
+// Reads until the server's output ends with the given prompt
+static bool ReadUntil(const int fd, const std::string& suffix)
+{
+    std::string received;
+    char buffer[4096];
+
+    while (received.size() < suffix.size() || received.compare(received.size() - suffix.size(), suffix.size(), suffix) != 0)
+    {
+        const ssize_t bytes = read(fd, buffer, sizeof(buffer));
+        if (bytes <= 0) return false;
+        received.append(buffer, bytes);
+    }
+
+    return true;
+}
+
+static void RunServer(const std::string& backend, const int port)
+{
+    Config::Get().Set("backend", backend);
+
+    int serverFd = EventLoop::Listen(port);
+    Game::Get().LoadAreas();
+    Simulation::Get().Start();
+
+    auto loop = EventLoop::Create(serverFd, EventLoop::ParseBackend(backend));
+    loop->Run();
+    exit(0);
+}
+
+// Server CPU time in microseconds, as reported by the kernel
+static double GetCpuTime(const pid_t pid)
+{
+    std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+    std::string field;
+    unsigned long long utime = 0, stime = 0;
+
+    for (int i = 1; i <= 15 && file >> field; ++i)
+    {
+        if (i == 14) utime = std::stoull(field);
+        if (i == 15) stime = std::stoull(field);
+    }
+
+    return (utime + stime) * 1e6 / sysconf(_SC_CLK_TCK);
+}
+
+static Result RunClients(const int port, const int nClients, const int nCommands)
+{
+    Result result;
+    std::mutex mutex;
+    std::atomic<int> ready = 0;
+    std::atomic<bool> go = false;
+    std::vector<std::thread> threads;
+
+    for (int c = 0; c < nClients; ++c)
+    {
+        threads.emplace_back([&, c]()
+        {
+            int fd = Connect(port);
+            if (fd < 0 || !ReadUntil(fd, "? ")) { perror("Unable to connect"); exit(-1); }
+
+            const std::string name = "bench" + std::to_string(c) + "\n";
+            send(fd, name.data(), name.size(), 0);
+            ReadUntil(fd, "> ");
+
+            ready++;
+            while (!go) std::this_thread::yield();
+
+            std::vector<double> latencies;
+            latencies.reserve(nCommands);
+            const std::string command = "unwield\n";
+
+            for (int i = 0; i < nCommands; ++i)
+            {
+                const auto start = Clock::now();
+                send(fd, command.data(), command.size(), 0);
+                if (!ReadUntil(fd, "> ")) break;
+                latencies.emplace_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            }
+
+            close(fd);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            result.latencies.insert(result.latencies.end(), latencies.begin(), latencies.end());
+        });
+    }
+
+    while (ready < nClients) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    const auto start = Clock::now();
+    go = true;
+    for (auto& thread : threads) thread.join();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    Config::Get().ParseArguments(argc, argv);
+    const int nClients = Config::Get().GetInt("clients", 32);
+    const int nCommands = Config::Get().GetInt("commands", 2000);
+    const int port = Config::Get().GetInt("port", 4100);
+
+    for (const std::string backend : { "epoll", "io_uring" })
+    {
+        const pid_t pid = fork();
+        if (pid == 0) RunServer(backend, port);
+
+        // Wait for the server to come up
+        int probe = -1;
+        while ((probe = Connect(port)) < 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        close(probe);
+
+        const double cpuBefore = GetCpuTime(pid);
+        auto result = RunClients(port, nClients, nCommands);
+        const double cpuAfter = GetCpuTime(pid);
+
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+
+        std::sort(result.latencies.begin(), result.latencies.end());
+        const auto Percentile = [&](const double p)
+        {
+            if (result.latencies.empty()) return 0.0;
+            return result.latencies[std::min(result.latencies.size() - 1, (size_t)(p * result.latencies.size()))];
+        };
+
+        const double roundTrips = result.latencies.size();
+        std::cout << backend << ": "
+                  << roundTrips / result.seconds << " round-trips/s, "
+                  << "p50 " << Percentile(0.5) << "us, "
+                  << "p99 " << Percentile(0.99) << "us, "
+                  << "server CPU " << (cpuAfter - cpuBefore) / roundTrips << "us/round-trip"
+                  << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+    Compares drawing random numbers from the C library's rand() (one
+    hidden state, behind a lock, shared by every thread) with drawing
+    them from a Random stream of each thread's own, as players do.
+
+    Usage: sludge_randbench [--threads=N] [--numbers=N]
+*/
+
+#include "Config.h"
+#include "Random.h"
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+typedef std::chrono::steady_clock Clock;
+
+// Where every thread's numbers end up summed, so none can be optimised away
+static std::atomic<uint64_t> sink(0);
+
+// Every thread draws the given count at once; returns the seconds it took them all
+template<typename F>
+static double Run(const int nThreads, const int nNumbers, F draw)
+{
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < nThreads; ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            while (!go) std::this_thread::yield();
+
+            uint64_t sum = 0;
+            draw(i, nNumbers, sum);
+            sink += sum;
+        });
+    }
+
+    const auto start = Clock::now();
+    go = true;
+    for (auto& thread : threads) thread.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return seconds;
+}
+
+int main(int argc, char** argv)
+{
+    Config::Get().ParseArguments(argc, argv);
+    const int nThreads = Config::Get().GetInt("threads", std::thread::hardware_concurrency());
+    const int nNumbers = Config::Get().GetInt("numbers", 10000000);
+
+    const double shared = Run(nThreads, nNumbers, [](int, const int n, uint64_t& sum)
+    {
+        for (int i = 0; i < n; ++i) sum += rand();
+    });
+
+    const double own = Run(nThreads, nNumbers, [](const int thread, const int n, uint64_t& sum)
+    {
+        Random random(thread);
+        for (int i = 0; i < n; ++i) sum += random.Next();
+    });
+
+    const double numbers = (double) nThreads * nNumbers;
+    for (const auto& [name, seconds] : { std::make_pair("rand()", shared), std::make_pair("Random", own) })
+    {
+        std::cout << name << ": "
+                  << numbers / seconds / 1e6 << "M numbers/s over " << nThreads << " threads, "
+                  << seconds * 1e9 / nNumbers << "ns/number per thread"
+                  << std::endl;
+    }
+
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include "Item.h"
 #include "Enemy.h"
 #include "Vendor.h"
+#include "ItemTable.h"
 
 class Area
 {
@@ -79,6 +80,12 @@ public:
         return {};
     }
 
+    // Whatever takes from or adds to a cell's items invalidates this
+    ItemTable& GetItemTable(const Cell cell)
+    {
+        return itemTables[cell];
+    }
+
     EnemyInstance* GetEnemy(const Cell cell)
     {
         if (enemies.count(cell)) return &enemies.at(cell);
@@ -90,6 +97,11 @@ public:
         enemies.erase(cell);
     }
 
+    void SpawnEnemy(const Cell cell, const EnemyID enemy, const int health)
+    {
+        enemies[cell] = { enemy, health };
+    }
+
     ItemID GetWeightedRandomItem(const std::vector<std::vector<ItemID>>& list)
     {
         // Items near the start of the list should be more common and to this end
@@ -107,5 +119,6 @@ protected:
     std::unordered_map<Cell, Portal> portals;
     std::unordered_map<Cell, Vendor> vendors;
     std::unordered_map<Cell, EnemyInstance> enemies;
+    std::unordered_map<Cell, ItemTable> itemTables;
     std::default_random_engine generator;
 };
\ No newline at end of file
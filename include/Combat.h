@@ -0,0 +1,64 @@
+#pragma once
+#include "Common.h"
+
+// Blows land within this fraction either side of their full strength
+#define COMBAT_DAMAGE_VARIATION 0.2f
+
+/*
+    The arithmetic of a fight, kept apart from the telling of it so
+    that the game and the balance simulator share it, and can't drift
+    apart. It's written for anything that does its sums like a float:
+    the game works out one blow at a time, whilst the simulator works
+    out vectors of them, with a fight in each lane.
+*/
+class Combat
+{
+public:
+    // How far from its full strength a blow lands, from a roll of 0 up to 1
+    template<typename T>
+    static T GetVariation(const T roll)
+    {
+        return (
+            roll                                //  0 to 1
+            * 2.0f - 1.0f                       // -1 to 1
+        )   * COMBAT_DAMAGE_VARIATION + 1.0f;   // -whatever to +whatever
+    }
+
+    // A player's blow always does some damage...
+    template<typename T>
+    static T GetAttackDamage(const T attack, const T variation)
+    {
+        const T damage = attack * variation;
+        return damage > 1.0f ? damage : 1.0f;
+    }
+
+    // ...but armour may turn an enemy's aside (though never so well that the player gains health!)
+    template<typename T>
+    static T GetDefenceDamage(const T damage, const T defence, const T variation)
+    {
+        const T taken = damage * variation - defence;
+        return taken > 0.0f ? taken : 0.0f;
+    }
+
+    // Health is kept whole, so a blow takes any fraction off along with it
+    template<typename Health, typename Damage>
+    static Health Wound(const Health health, const Damage damage)
+    {
+        return Convert<Health>(Convert<Damage>(health) - damage);
+    }
+
+    // The player's beaten once their health drops below 0, and the enemy once theirs reaches it
+    template<typename Health>
+    static auto IsOver(const Health playerHealth, const Health enemyHealth)
+    {
+        return (playerHealth < 0) | (enemyHealth <= 0);
+    }
+
+private:
+    template<typename To, typename From>
+    static To Convert(const From value)
+    {
+        if constexpr (std::is_arithmetic_v<From>) return (To) value;
+        else return __builtin_convertvector(value, To);
+    }
+};
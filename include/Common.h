@@ -2,11 +2,13 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstring>
 #include <unordered_map>
 #include <cstdio>
 #include <thread>
+#include <mutex>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -17,6 +19,7 @@
 #include <list>
 #include <optional>
 #include <functional>
+#include <memory>
 
 typedef int Cell;
 typedef size_t AreaID;
@@ -0,0 +1,36 @@
+#pragma once
+#include "Common.h"
+#include "OutputQueue.h"
+
+#include <zlib.h>
+
+/*
+    One client's MCCP2 stream: a single deflate stream covering all
+    output from the moment compression starts. Output is compressed
+    as it's queued, then flushed to a byte boundary just before it's
+    sent so that the client can show it straight away. The window and
+    memory levels decide how much memory each stream costs.
+*/
+class Compressor
+{
+public:
+    Compressor(const int level, const int windowBits, const int memoryLevel);
+    ~Compressor();
+
+    Compressor(Compressor const&) = delete;
+    void operator=(Compressor const&) = delete;
+
+    bool IsValid() const { return valid; }
+    bool HasPending() const { return pending; }
+
+    void Compress(std::string_view string, OutputQueue& output);
+    void Flush(OutputQueue& output);
+    void Finish(OutputQueue& output);
+
+private:
+    z_stream stream;
+    bool valid;
+    bool pending;
+
+    void Deflate(const int flush, OutputQueue& output);
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include "Common.h"
+
+/*
+    Server settings, read from data/config.txt as "key = value" lines
+    and optionally overridden on the command line with --key=value.
+    Anything missing simply falls back to the default given by the
+    caller, so the file only needs to mention what differs.
+*/
+class Config
+{
+public:
+
+    static Config& Get()
+    {
+        // Guaranteed to be instantiated and destroyed by the compiler
+        static Config config;
+        return config;
+    }
+
+    Config(Config const&) = delete;
+    void operator=(Config const&) = delete;
+
+    void ParseArguments(const int argc, char** argv);
+    void Set(const std::string& key, const std::string& value);
+
+    std::string GetString(const std::string& key, const std::string& fallback) const;
+    int GetInt(const std::string& key, const int fallback) const;
+
+private:
+    Config();
+    ~Config() {}
+
+    std::unordered_map<std::string, std::string> values;
+};
@@ -1,9 +1,130 @@
 #pragma once
 #include "Common.h"
+#include "LineAssembler.h"
+#include "OutputQueue.h"
+#include "Compressor.h"
+#include "Telnet.h"
+#include "TimerWheel.h"
+#include "Simulation.h"
 
+class EventLoop;
+
+// Largest chunk of input handed over by a backend in one go
+#define BUFFER_SIZE 2048
+
+/*
+    A single client, driven entirely by events from whichever event
+    loop backend owns it. The connection itself never touches the
+    socket: backends hand it whatever bytes arrive and send whatever
+    output it has queued, so epoll and io_uring can share all of the
+    session logic.
+*/
 class Connection
 {
 public:
-    Connection(int clientFd, const std::string address);
+
+    enum class State
+    {
+        Naming,     // Waiting for the player to choose a name
+        Playing,    // Name chosen, commands go to the game
+        Closing,    // Flushing any last output before closing
+        Closed
+    };
+
+    // Everything needed to carry a session over into a new process
+    struct Snapshot
+    {
+        int fd;
+        std::string address;
+        State state;
+        std::string player;
+        std::string input;      // Framed, but not yet run
+        std::string unread;     // Received, but not yet framed
+        std::string output;     // Not yet sent
+        bool compressed;        // Had compression on, so it's offered again
+    };
+
+    // Reads (and reports on) the configured settings, so that mistakes show at
+    // startup rather than with the first client
+    static void CheckSettings();
+
+    Connection(int clientFd, const std::string& address, EventLoop& loop);
+    Connection(const Snapshot& snapshot, EventLoop& loop);
     ~Connection();
-};
\ No newline at end of file
+
+    Connection(Connection const&) = delete;
+    void operator=(Connection const&) = delete;
+
+    // Returns how much input was taken, which falls short only whilst paused
+    size_t OnReceive(const char* data, const size_t size);
+    void OnHangup();
+
+    // Commands stop being read whilst too much output is backed up (or
+    // whilst too many are waiting on the simulation), so a client that
+    // doesn't keep up only ever holds up itself
+    bool WantsInput() const { return IsRunning() && input.Free() > 0; }
+    size_t InputSpace() const { return input.Free(); }
+
+    // Fills in vectors for whatever output is pending; if in flight, these
+    // stay valid until OnSent() says how much went, so sends may be kept
+    // waiting on the kernel (otherwise they're sent straight away)
+    int GatherOutput(iovec* vectors, const int maxVectors, const bool inFlight);
+    void OnSent(const size_t bytes);
+    // Takes whatever the simulation has sent back
+    void OnReplies();
+
+    bool HasOutput() const { return !output.Empty() || (compressor && compressor->HasPending()); }
+
+    // Ends any compressed stream (which can't be carried over) before copying
+    // out the session, after which it's only fit for handing over or for
+    // carrying on with OfferCompression()
+    Snapshot Save();
+    void OfferCompression();
+
+    bool IsReading() const { return state == State::Naming || state == State::Playing; }
+    bool IsClosed() const { return state == State::Closed; }
+
+    const int fd;
+    const std::string address;
+
+private:
+    EventLoop& loop;
+    State state;
+    std::string playerName;
+    bool paused;
+
+    // Commands go off to the simulation, and replies come back some time later
+    int inFlight;
+    std::shared_ptr<Session> session;
+
+    // Connections that sit idle (or never log in, or stop reading their output)
+    // are timed out; the idle timer is only pushed back lazily when it fires
+    TimerID loginTimer;
+    TimerID idleTimer;
+    TimerID stallTimer;
+    uint64_t lastActive;
+
+    Telnet telnet;
+    LineAssembler input;
+    OutputQueue output;
+    std::unique_ptr<Compressor> compressor;
+
+    bool IsRunning() const { return IsReading() && !paused; }
+    void ProcessInput();
+    void OnLine(const std::string& line);
+    void Post(const Command::Type type, const std::string& text);
+    void OnReply(Reply& reply);
+    void OnNegotiation(const Telnet::Negotiation& negotiation);
+
+    void Send(const char* string) { Send(std::string_view(string)); }
+    void Send(std::string_view string);
+    void Send(std::string&& string);
+    void Send(const std::shared_ptr<const std::string>& string);
+    void Send(std::string&& string, const std::vector<OutputSplice>& splices);
+    void CheckOutput();
+    void OnSlowClient();
+
+    void OnLoginTimeout();
+    void OnIdleTimeout();
+    void OnStallTimeout();
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include "Common.h"
+#include "EventLoop.h"
+
+/*
+    Edge-triggered epoll reactor; the portable backend. Every event
+    must be drained until the kernel tells us it would block.
+*/
+class EpollLoop : public EventLoop
+{
+public:
+    EpollLoop(int serverFd);
+    ~EpollLoop();
+
+    void Run() override;
+    void Adopt(const Connection::Snapshot& snapshot) override;
+
+private:
+    int epollFd;
+
+    void OnAccept();
+    void OnReadable(Connection& connection);
+    void OnWritable(Connection& connection);
+    void OnUnblocked(Connection& connection) override;
+    void Flush();
+    void CloseConnection(const int fd);
+};
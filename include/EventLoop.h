@@ -0,0 +1,86 @@
+#pragma once
+#include "Common.h"
+#include "Connection.h"
+#include "TimerWheel.h"
+#include "Simulation.h"
+
+#include <memory>
+
+/*
+    Owns the listening socket and every client, so that one thread
+    can serve every connection instead of one (mostly idle) thread
+    per player. How readiness or completion is learnt about is left
+    to the backends.
+*/
+class EventLoop
+{
+public:
+
+    enum class Backend
+    {
+        Epoll,
+        Uring
+    };
+
+    // Makes the requested backend, falling back to epoll if it's unsupported
+    static std::unique_ptr<EventLoop> Create(int serverFd, const Backend backend);
+    static Backend ParseBackend(const std::string& name);
+    static int Listen(const int port);
+
+    virtual ~EventLoop();
+
+    EventLoop(EventLoop const&) = delete;
+    void operator=(EventLoop const&) = delete;
+
+    virtual void Run() = 0;
+
+    // Asks every loop to return from Run() as soon as it can; Continue() undoes
+    // that, so the loops may be run again
+    static void Stop();
+    static void Continue();
+
+    // Copies out every live session for handing over to a new process
+    virtual std::vector<Connection::Snapshot> Save();
+
+    // Carries on with sessions after all, should the new process fail
+    void Resume(const std::vector<Connection::Snapshot>& snapshots);
+
+    // Takes on a session handed over by an old process, before Run()
+    virtual void Adopt(const Connection::Snapshot& snapshot) = 0;
+
+    // Connection timeouts run on the loop's own wheel, and any connection
+    // they touch is woken so its output (or hang-up) is dealt with
+    TimerWheel& GetTimers() { return timers; }
+    void Wake(const int fd) { dirty.emplace_back(fd); }
+
+    // Called by the simulation when a session has replies waiting
+    void Notify(const std::shared_ptr<Session>& session);
+
+protected:
+    EventLoop(int serverFd);
+
+    int serverFd;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<int> dirty;
+    TimerWheel timers;
+
+    // Sessions with replies waiting, and an event to wake the loop for them
+    MpscQueue<std::shared_ptr<Session>> ready;
+    std::atomic<bool> signalled;
+    int wakeFd;
+
+    Connection& AddConnection(int clientFd);
+    Connection& AddConnection(const Connection::Snapshot& snapshot);
+
+    static int GetStopFd();
+
+    // Hands replies over to their connections, once wakeFd is readable
+    void DeliverReplies();
+
+    // For a connection that had stopped taking input and now wants more
+    virtual void OnUnblocked(Connection& connection) = 0;
+
+    // Fires the loop's timers and the game's, returning how long (in
+    // milliseconds) the loop may sleep before either needs it again
+    int RunTimers();
+};
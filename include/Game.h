@@ -3,6 +3,12 @@
 #include "Item.h"
 #include "Player.h"
 #include "Enemy.h"
+#include "Narration.h"
+
+#include <atomic>
+#include "PlayerRegistry.h"
+#include "Tokenizer.h"
+#include "VerbTable.h"
 
 class Game
 {
@@ -23,10 +29,10 @@ private:
     ~Game();
 
 public:
-    std::unordered_map<std::string, Player> players;
+    PlayerRegistry players;
     std::vector<Area*> areas;
 
-    std::string motd;
+    std::shared_ptr<const std::string> motd;
     unsigned int seed;
     std::vector<std::string> vendorNames;
 
@@ -36,22 +42,17 @@ public:
     std::vector<ItemID> foods;
     std::vector<Enemy> enemies;
     std::vector<Item> items;
-    
-    std::vector<std::string> attackVerbs;
-    std::vector<std::string> attackMinimalDamageDescriptions;
-    std::vector<std::string> attackModerateDamageDescriptons;
-    std::vector<std::string> attackMajorDamageDescriptions;
-
-    std::vector<std::string> combatPrefixes;
-    std::vector<std::string> combatObjects;
-    
-    std::vector<std::string> defenceMinimalDamageDescriptions;
-    std::vector<std::string> defenceModerateDamageDescriptons;
-    std::vector<std::string> defenceMajorDamageDescriptions;
+    Narration narration;
 
+    // Any strand; players stay put once added, but each is only to be
+    // touched by the strand running its session
     Player* AddPlayer(const std::string& name);
     Player* GetPlayer(const std::string& name);
 
+    // A stream for a new player that no earlier one of the same name has had, in
+    // this process or any other, so a name taken again never replays its fights
+    Random MakeRandom(const std::string& name);
+
     AreaID AddArea(Area* area);
     AreaID GetAreaID(Area* area);
 
@@ -61,8 +62,63 @@ public:
     // initialisation loop!
     void LoadAreas();
 
+    // Both return whether the player's still alive. A line may hold several
+    // commands separated by ;, all run before their output goes out; one that
+    // takes the player through a portal stops short, and the rest of the line
+    // carries on with OnArrival() once on the strand of the area they're in
     bool OnCommand(const std::string& string, Player& player);
+    bool OnArrival(Player& player);
     void PrintItems(Player& player, bool showIfEmpty);
     void PrintItems(Player& player, const std::vector<ItemStack>& itemStacks);
-    bool OnCombat(Player& player, EnemyInstance& enemy);
+    void PrintItems(Player& player, const std::vector<ItemStack>& itemStacks, ItemTable& table);
+
+    // One exchange of blows in the player's fight, run each combat tick; returns whether
+    // they're still alive, leaving them without a foe once the fight's over either way
+    bool OnExchange(Player& player);
+
+private:
+    void OnEncounter(Player& player);
+    void OnAttack(Player& player, EnemyInstance& enemyInstance);
+    void OnDefend(Player& player, EnemyInstance& enemyInstance);
+    void DrawItems(Output& output, const std::vector<ItemStack>& itemStacks);
+
+    // Each verb's handler returns whether the player's still alive
+    typedef Verb<bool (Game::*)(Player& player, const Tokenizer& arguments)> GameVerb;
+    static const auto& GetVerbs();
+
+    // Tells the player if they haven't one
+    std::optional<ItemID> GetNthItem(Player& player, const size_t n);
+
+    // Runs commands separated by ;, expanding aliases, until the budget runs out
+    bool OnCommands(std::string_view commands, Player& player, unsigned int& budget);
+    bool OnCommand(const Tokenizer& arguments, Player& player);
+
+    bool OnHelp(Player& player, const Tokenizer& arguments);
+    bool OnWield(Player& player, const Tokenizer& arguments);
+    bool OnWear(Player& player, const Tokenizer& arguments);
+    bool OnConsume(Player& player, const Tokenizer& arguments);
+    bool OnUnwield(Player& player, const Tokenizer& arguments);
+    bool OnUnwear(Player& player, const Tokenizer& arguments);
+    bool OnLook(Player& player, const Tokenizer& arguments);
+    bool OnItems(Player& player, const Tokenizer& arguments);
+    bool OnGet(Player& player, const Tokenizer& arguments);
+    bool OnBrowse(Player& player, const Tokenizer& arguments);
+    bool OnBuy(Player& player, const Tokenizer& arguments);
+    bool OnSell(Player& player, const Tokenizer& arguments);
+    void SellAll(Player& player, Vendor& vendor, const std::string_view match);
+    bool OnInfo(Player& player, const Tokenizer& arguments);
+    bool OnMove(Player& player, const Tokenizer& arguments);
+    bool OnAlias(Player& player, const Tokenizer& arguments);
+    bool OnUnalias(Player& player, const Tokenizer& arguments);
+    bool OnMap(Player& player, const Tokenizer& arguments);
+    bool OnQuit(Player& player, const Tokenizer& arguments);
+    bool OnUp(Player& player, const Tokenizer& arguments);
+    bool OnDown(Player& player, const Tokenizer& arguments);
+    bool OnLeft(Player& player, const Tokenizer& arguments);
+    bool OnRight(Player& player, const Tokenizer& arguments);
+
+    // Mixed into every player's stream: one salt for the process, and a count of
+    // every player it's made
+    uint64_t salt;
+    std::atomic<uint64_t> incarnations;
 };
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include "Common.h"
+#include "Connection.h"
+
+/*
+    Upgrades a running server in place without dropping anybody. On
+    SIGUSR2 the server starts a fresh copy of its binary and waits for
+    it to load the game; only then do the event loops stop, and every
+    listener and client socket is passed across a Unix socket (with
+    SCM_RIGHTS), along with the players and each session's state. The
+    old process leaves once the new one has taken it all on, and until
+    then the kernel holds onto anything clients send, so the only cost
+    is a pause of a few milliseconds.
+*/
+class HotRestart
+{
+public:
+
+    struct Handoff
+    {
+        std::vector<int> serverFds;
+
+        // One list of sessions per shard
+        std::vector<std::vector<Connection::Snapshot>> sessions;
+    };
+
+    // Called before any threads start, so that only the main thread sees SIGUSR2
+    static void Prepare(char** argv);
+
+    // Old process: blocks until a restart is asked for
+    static void WaitForRequest();
+
+    // Old process: starts the new binary, returning a channel to it once it's
+    // ready to take over, or -1 if it never got that far
+    static int Launch();
+
+    // Old process: passes everything over, and true once the new process has it
+    static bool HandOver(const int channel, const Handoff& handoff);
+
+    // New process: whether we were started by Launch()
+    static bool IsResuming();
+
+    // New process: takes everything over (players included), once the game's loaded
+    static bool Receive(Handoff& handoff);
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include "Common.h"
+#include "Item.h"
+
+/*
+    A player's items, as stacks kept in one vector in order of item.
+    Players number their items from 1, and with the stacks always in
+    the same order those numbers hold still: they only move when a
+    stack comes or goes, and the Nth stack is found directly. Players
+    never carry so many kinds of item that finding one by binary search
+    (or moving the rest along to make room for one) costs much.
+*/
+class Inventory
+{
+public:
+    void Add(const ItemID item, const unsigned int number = 1)
+    {
+        const auto it = LowerBound(item);
+        if (it != stacks.end() && it->item == item) it->number += number;
+        else stacks.emplace(it, item, number);
+    }
+
+    // Takes away up to that many, and returns whether the stack's now gone
+    bool Remove(const ItemID item, const unsigned int number = 1)
+    {
+        const auto it = LowerBound(item);
+        if (it == stacks.end() || it->item != item) return true;
+
+        if (it->number > number)
+        {
+            it->number -= number;
+            return false;
+        }
+
+        stacks.erase(it);
+        return true;
+    }
+
+    unsigned int Count(const ItemID item) const
+    {
+        const auto it = std::lower_bound(stacks.begin(), stacks.end(), item, Before);
+        return it != stacks.end() && it->item == item ? it->number : 0;
+    }
+
+    // Counting from 1; null if there's no such stack
+    const ItemStack* GetNth(const size_t n) const
+    {
+        if (n == 0 || n > stacks.size()) return nullptr;
+        return &stacks[n - 1];
+    }
+
+    const std::vector<ItemStack>& GetStacks() const { return stacks; }
+    size_t Size() const { return stacks.size(); }
+    bool Empty() const { return stacks.empty(); }
+
+    std::vector<ItemStack>::const_iterator begin() const { return stacks.begin(); }
+    std::vector<ItemStack>::const_iterator end() const { return stacks.end(); }
+
+    // Empties it, giving back its memory
+    void Release() { std::vector<ItemStack>().swap(stacks); }
+
+private:
+    std::vector<ItemStack> stacks;
+
+    static bool Before(const ItemStack& stack, const ItemID item) { return stack.item < item; }
+
+    std::vector<ItemStack>::iterator LowerBound(const ItemID item)
+    {
+        return std::lower_bound(stacks.begin(), stacks.end(), item, Before);
+    }
+};
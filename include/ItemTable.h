@@ -0,0 +1,19 @@
+#pragma once
+#include "Common.h"
+
+/*
+    A list of items' table, as last drawn. Whatever changes the list
+    bumps its version, and the table's only drawn again once the version
+    it was drawn at falls behind; until then every view shares the same
+    text, which is never changed (only replaced), so output still on its
+    way out holds onto whichever table it was given.
+*/
+struct ItemTable
+{
+    uint64_t version = 0;
+    uint64_t drawn = 0;
+    std::shared_ptr<const std::string> text;
+
+    void Invalidate() { version++; }
+    bool IsStale() const { return !text || drawn != version; }
+};
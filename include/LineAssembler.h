@@ -0,0 +1,42 @@
+#pragma once
+#include "Common.h"
+
+#include <memory>
+
+#define INPUT_BUFFER_SIZE 4096 // Must be a power of two
+#define MAX_LINE_LENGTH 512
+
+/*
+    Frames a client's byte stream into lines, however TCP happened to
+    split or merge them. Bytes go into a fixed ring buffer and come
+    out one complete line at a time (without the "\n" or "\r\n"), so
+    partial lines wait for the rest whilst several pipelined commands
+    from one read queue up behind each other. Lines that run longer
+    than MAX_LINE_LENGTH are cut off there, and the rest discarded.
+*/
+class LineAssembler
+{
+public:
+    LineAssembler();
+    ~LineAssembler() {}
+
+    // Returns how much was taken, which falls short only if the buffer filled up
+    size_t Append(const char* data, const size_t size);
+    bool Pop(std::string& line);
+
+    // Copies out everything buffered, partial line included
+    std::string Contents() const;
+
+    bool HasLine() const { return lines > 0; }
+    size_t Free() const { return INPUT_BUFFER_SIZE - count; }
+
+private:
+    std::unique_ptr<char[]> buffer;
+    size_t head;
+    size_t count;
+    size_t lines;
+    size_t partialLength;
+    bool discarding;
+
+    bool Push(const char* data, const size_t size);
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include "Common.h"
+
+#include <atomic>
+
+/*
+    Unbounded lock-free queue for any number of producers and a single
+    consumer (after Dmitry Vyukov's). Pushing is one atomic exchange
+    and never waits on anybody else; popping is done by the owning
+    thread alone. Items come out in the order each producer pushed
+    them, so commands from one connection always run in order.
+*/
+template<typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head(new Node()), tail(head.load()) {}
+
+    ~MpscQueue()
+    {
+        T value;
+        while (Pop(value));
+        delete tail;
+    }
+
+    MpscQueue(MpscQueue const&) = delete;
+    void operator=(MpscQueue const&) = delete;
+
+    // Any thread
+    void Push(T value)
+    {
+        Node* node = new Node();
+        node->value = std::move(value);
+
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer only; may briefly miss an item whose push is still under way
+    bool Pop(T& value)
+    {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) return false;
+
+        // The popped node becomes the new (empty) front, and the old one goes
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+    // Consumer only
+    bool Empty() const { return tail->next.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node
+    {
+        T value;
+        std::atomic<Node*> next = nullptr;
+    };
+
+    // Producers and the consumer each keep to their own cache line
+    alignas(64) std::atomic<Node*> head;
+    alignas(64) Node* tail;
+};
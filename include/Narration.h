@@ -0,0 +1,83 @@
+#pragma once
+#include "Common.h"
+#include "Enemy.h"
+#include "Output.h"
+#include "Random.h"
+
+/*
+    Everything a fight is told with, compiled at load time from the
+    combat data files (and every enemy's own words) into one flat
+    table. Phrases are packed end to end in a single string, each
+    found by where it starts and how long it is, and already joined
+    to whatever always follows them (a verb's space, the ". " after
+    an object), with capitalised copies of any that may start a
+    sentence. Telling a blow is then a few random picks and four
+    writes straight into the player's output.
+*/
+class Narration
+{
+public:
+    // Reads the data files; missing ones leave their phrases with nothing to say
+    void Load(const std::vector<Enemy>& enemies);
+
+    // One line each for the player's blow and the enemy's, told by how much
+    // health whoever was struck has left (as a fraction of their full health)
+    void TellAttack(Output& output, Random& random, const EnemyID enemy, const float health) const;
+    void TellDefence(Output& output, Random& random, const EnemyID enemy, const float health) const;
+
+private:
+    struct Phrase
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    // A run of the table's phrases
+    struct List
+    {
+        uint32_t first = 0;
+        uint32_t size = 0;
+    };
+
+    // However badly hurt whoever was struck is, from barely to badly
+    enum Damage
+    {
+        Minimal,
+        Moderate,
+        Major,
+        NUM_DAMAGES
+    };
+
+    struct EnemyPhrases
+    {
+        Phrase attackObject;        // "the [name]. "
+        Phrase defenceObject;       // "the [name] "
+        Phrase capitalisedObject;   // "The [name] "
+        std::vector<List> attacks;  // "[verb] you with its [limb]. ", for each attack's verbs
+    };
+
+    std::string text;
+    std::vector<Phrase> phrases;
+
+    Phrase attackHead;              // "- You "
+    List attackHeads;               // "- [prefix] you "
+    List attackVerbs;               // "[verb] "
+    List attackObjects;             // "[object]. "
+    List attackDamages[NUM_DAMAGES];// "[description]\n"
+
+    Phrase defenceHead;             // "- "
+    List defenceHeads;              // "- [prefix] "
+    List defenceObjects;            // "[object] "
+    List capitalisedObjects;        // "[Object] "
+    List defenceDamages[NUM_DAMAGES];
+
+    std::vector<EnemyPhrases> enemies;
+
+    Phrase Add(const std::string_view before, const std::string_view phrase, const std::string_view after, const bool capitalised = false);
+    List Add(const std::string_view before, const std::vector<std::string>& list, const std::string_view after, const bool capitalised = false);
+
+    std::string_view Get(const Phrase phrase) const { return std::string_view(text.data() + phrase.offset, phrase.length); }
+    std::string_view Pick(Random& random, const List list) const { return Get(phrases[list.first + random.Below(list.size)]); }
+
+    static Damage GetDamage(const float health);
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include "Common.h"
+
+#include <charconv>
+#include <type_traits>
+
+// Reservations for each new buffer, at least and at most
+#define OUTPUT_MIN_RESERVE 256
+#define OUTPUT_MAX_RESERVE 16384
+
+// Shared text any shorter is cheaper copied in than sent out as a piece of its own
+#define OUTPUT_MIN_SPLICE 512
+
+/*
+    A number written out into a little buffer of its own, for wherever
+    it's wanted as text without making a string of it.
+*/
+class NumberText
+{
+public:
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    NumberText(const T value) : length(std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer) {}
+
+    // Fixed, with six decimal places, as std::to_string() would have it
+    NumberText(const double value) : length(std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 6).ptr - buffer) {}
+
+    std::string_view View() const { return std::string_view(buffer, length); }
+
+private:
+    // Enough for any double written out in full
+    char buffer[std::numeric_limits<double>::max_exponent10 + 16];
+    size_t length;
+};
+
+// Shared text to go out as it is, once however much of the buffer comes before it has
+struct OutputSplice
+{
+    size_t offset;
+    std::shared_ptr<const std::string> text;
+};
+
+/*
+    Text on its way to a player, built up in one buffer. Numbers are
+    written straight in rather than by way of temporary strings, and
+    padding goes in all at once. Taking the text hands over the buffer
+    itself; the next is reserved (on its first write) at the size the
+    last one came to, so however many pieces a command's output is
+    built from, it usually costs a single allocation. Shared text (like
+    a cached table) is spliced in by reference rather than copied.
+*/
+class Output
+{
+public:
+    Output() : expected(OUTPUT_MIN_RESERVE) {}
+
+    Output& operator<< (const std::string_view string)
+    {
+        Reserve();
+        text += string;
+        return *this;
+    }
+
+    Output& operator<< (const char* string) { return *this << std::string_view(string); }
+    Output& operator<< (const std::string& string) { return *this << std::string_view(string); }
+
+    Output& operator<< (const std::shared_ptr<const std::string>& shared)
+    {
+        if (shared->size() < OUTPUT_MIN_SPLICE) return *this << std::string_view(*shared);
+
+        splices.push_back({ text.size(), shared });
+        spliced += shared->size();
+        return *this;
+    }
+
+    Output& operator<< (const char c)
+    {
+        Reserve();
+        text += c;
+        return *this;
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>>
+    Output& operator<< (const T value)
+    {
+        return *this << NumberText(value).View();
+    }
+
+    // Pieces one after another, each copied straight in
+    Output& Write(const std::initializer_list<std::string_view> pieces)
+    {
+        Reserve();
+        for (const std::string_view piece : pieces) text.append(piece.data(), piece.size());
+        return *this;
+    }
+
+    Output& Fill(const size_t count, const char c)
+    {
+        Reserve();
+        text.append(count, c);
+        return *this;
+    }
+
+    bool Empty() const { return text.empty() && splices.empty(); }
+    size_t Size() const { return text.size() + spliced; }
+
+    // Hands over everything written so far, leaving this empty; any shared
+    // text goes along with it, into the splices given
+    std::string Take(std::vector<OutputSplice>& taken)
+    {
+        taken = std::move(splices);
+        splices.clear();
+        spliced = 0;
+        return Take();
+    }
+
+    // As above, for output known to have nothing spliced in
+    std::string Take()
+    {
+        expected = std::clamp(text.size(), (size_t) OUTPUT_MIN_RESERVE, (size_t) OUTPUT_MAX_RESERVE);
+        std::string taken = std::move(text);
+        text = std::string();
+        return taken;
+    }
+
+    // Throws away anything written, giving back its memory
+    void Release()
+    {
+        std::string().swap(text);
+        std::vector<OutputSplice>().swap(splices);
+        spliced = 0;
+        expected = OUTPUT_MIN_RESERVE;
+    }
+
+private:
+    std::string text;
+    size_t expected;
+
+    std::vector<OutputSplice> splices;
+    size_t spliced = 0;
+
+    void Reserve()
+    {
+        if (text.capacity() < expected) text.reserve(expected);
+    }
+};
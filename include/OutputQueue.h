@@ -0,0 +1,61 @@
+#pragma once
+#include "Common.h"
+
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <sys/uio.h>
+
+// Most segments handed to the kernel in one send
+#define MAX_OUTPUT_VECTORS 64
+
+/*
+    A connection's pending output, kept as a queue of segments that
+    are sent together with one vectored write. Small pieces are packed
+    into the segment at the back, large strings are moved in whole,
+    and shared payloads (like the motd) are referenced rather than
+    copied. Once a segment has been handed out for sending it's left
+    untouched until sent, so sends may stay in flight whilst more
+    output queues up behind them.
+*/
+class OutputQueue
+{
+public:
+    OutputQueue() : frontOffset(0), sealed(0), size(0) {}
+    ~OutputQueue() {}
+
+    void Append(std::string_view string);
+    void Append(std::string&& string);
+    void Append(const std::shared_ptr<const std::string>& string);
+
+    // Fills in vectors for as much as can go at once, returning how many were used;
+    // if they're to stay in flight (rather than be sent there and then), their
+    // segments are left untouched until Consume() says how much went
+    int Gather(iovec* vectors, const int maxVectors, const bool inFlight);
+    void Consume(size_t bytes);
+
+    // Copies out everything not yet sent
+    std::string Contents() const;
+
+    // Throws away everything not in flight
+    void DropUnsent();
+
+    size_t Size() const { return size; }
+    bool Empty() const { return size == 0; }
+
+private:
+    struct Segment
+    {
+        std::string owned;
+        std::shared_ptr<const std::string> shared;
+
+        std::string_view View() const { return shared ? std::string_view(*shared) : std::string_view(owned); }
+    };
+
+    std::deque<Segment> segments;
+    size_t frontOffset;
+    size_t sealed;
+    size_t size;
+
+    bool CanPack() const { return segments.size() > sealed && !segments.back().shared; }
+};
@@ -1,13 +1,17 @@
 #pragma once
 #include "Common.h"
-#include "Item.h"
+#include "Inventory.h"
+#include "Output.h"
+#include "Random.h"
+
+#include <map>
 
 #define MAX_PLAYER_HEALTH 100
 
 class Player
 {
 public:
-    Player(const std::string& name, unsigned int area, const Cell cell) : name(name), level(0), area(area), health(MAX_PLAYER_HEALTH), money(1000), cell(cell) {};
+    Player(const std::string& name, unsigned int area, const Cell cell) : name(name), level(0), area(area), health(MAX_PLAYER_HEALTH), money(1000), cell(cell), pendingBudget(0), pinnedMap(false), hibernated(false) {};
     ~Player() {}
 
     std::string name;
@@ -17,46 +21,72 @@ public:
     int money;
     Cell cell;
 
-    std::unordered_map<ItemID, unsigned int> items;
+    // The player's own stream, for whatever happens to them (see Game::MakeRandom())
+    Random random;
+
+    Inventory items;
     std::optional<ItemID> weapon;
     std::optional<ItemID> armour;
+
+    // The enemy in the player's cell that they're fighting, if any, which only
+    // comes to blows as the area's combat ticks come round
+    std::optional<EnemyID> foe;
     
-    std::string outputBuffer;
+    Output output;
 
-    template<typename T>
-    Player& operator<< (const T& i)
-    {
-        outputBuffer += std::to_string(i);
-        return *this;
-    }
+    // Names the player's given to batches of commands, and the commands; found
+    // straight from a view of the verb, without making a string of it
+    std::map<std::string, std::string, std::less<>> aliases;
 
-    Player& operator<< (const char* s)
-    {
-        outputBuffer += std::string(s);
-        return *this;
-    }
+    // Whatever's left of a batch of commands whilst the player crosses into
+    // another area, and how many more commands it may run
+    std::string pendingCommands;
+    unsigned int pendingBudget;
+
+    // Whether the player's map of the world stays at the top of their screen, only
+    // redrawn where it's changed, and what it last showed (if anything, on this connection)
+    bool pinnedMap;
+    std::string shownMap;
+
+    // Gone long enough to have been written out to disk, with only this much left in memory
+    bool hibernated;
 
-    Player& operator<< (const std::string& s)
+    template<typename T>
+    Player& operator<< (const T& value)
     {
-        outputBuffer += s;
+        output << value;
         return *this;
     }
 
-    std::vector<ItemStack> GetItemsAsList() const
+    // Starts the player over as new, in place, with everything but their name
+    // (which others may be reading whilst they look the player up) made afresh
+    void Reset(const unsigned int startArea, const Cell startCell, Random&& startRandom)
     {
-        std::vector<ItemStack> list;
-        for (const auto& [key, value] : items)
-            list.emplace_back(key, value);
-        return list;
+        Player fresh(std::string(), startArea, startCell);
+
+        level = fresh.level;
+        area = fresh.area;
+        health = fresh.health;
+        money = fresh.money;
+        cell = fresh.cell;
+        random = startRandom;
+        items = std::move(fresh.items);
+        weapon = fresh.weapon;
+        armour = fresh.armour;
+        foe = fresh.foe;
+        output = std::move(fresh.output);
+        aliases = std::move(fresh.aliases);
+        pendingCommands = std::move(fresh.pendingCommands);
+        pendingBudget = fresh.pendingBudget;
+        pinnedMap = fresh.pinnedMap;
+        shownMap = std::move(fresh.shownMap);
+        hibernated = fresh.hibernated;
     }
 
-    void RemoveItem(ItemID itemID)
+    void RemoveItem(ItemID itemID, unsigned int number = 1)
     {
-        if (items[itemID] > 1) items[itemID]--;
-        else
+        if (items.Remove(itemID, number))
         {
-            items.erase(itemID);
-
             // If item was wielded, unweild
             if (weapon == itemID) weapon.reset();
 
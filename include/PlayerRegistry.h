@@ -0,0 +1,96 @@
+#pragma once
+#include "Common.h"
+#include "Player.h"
+
+#include <atomic>
+
+#define PLAYER_REGISTRY_SHARDS 64
+#define PLAYER_CHUNK_BITS 10
+#define PLAYER_CHUNK_SIZE (1 << PLAYER_CHUNK_BITS)
+#define PLAYER_MAX_CHUNKS 4096
+
+/*
+    Every player, by name, for any thread to look up. Players live in
+    a pool of fixed-size chunks that are never moved or freed, so once
+    made a player stays at the same address for good, and is known
+    inside the registry by its index there (a handle). Names hash to
+    one of a number of shards, each an open-addressed table of handles:
+    looking a name up never takes a lock, and claiming one only locks
+    its shard, so logins spread across however many cores there are.
+    Players are never removed.
+*/
+class PlayerRegistry
+{
+public:
+    PlayerRegistry();
+    ~PlayerRegistry();
+
+    PlayerRegistry(PlayerRegistry const&) = delete;
+    void operator=(PlayerRegistry const&) = delete;
+
+    // Any thread; claims the player's name and moves them in, all in one go,
+    // or returns null (leaving the player be) if somebody already has it
+    Player* Reserve(Player&& player);
+
+    // Any thread, without locking
+    Player* Find(const std::string& name) const;
+
+    size_t Size() const { return count.load(std::memory_order_acquire); }
+
+    // Any thread; holds off every Reserve() until it's done, as a player counted
+    // may otherwise still be being moved in. The players themselves are only
+    // safe to touch whilst nothing else is (with the simulation paused, say)
+    template<typename F>
+    void ForEach(F f) const
+    {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(PLAYER_REGISTRY_SHARDS);
+        for (const Shard& shard : shards) locks.emplace_back(shard.mutex);
+
+        const uint32_t size = count.load(std::memory_order_acquire);
+        for (uint32_t handle = 0; handle < size; ++handle)
+            f(*Get(handle));
+    }
+
+private:
+    typedef uint32_t Handle;
+
+    // Each entry packs some of the name's hash (to skip most mismatches without
+    // looking at the player) above the handle plus one, with 0 meaning empty
+    struct Table
+    {
+        Table(const size_t capacity) : mask(capacity - 1), entries(new std::atomic<uint64_t>[capacity]())
+        {
+            for (size_t i = 0; i < capacity; ++i) entries[i].store(0, std::memory_order_relaxed);
+        }
+
+        ~Table() { delete[] entries; }
+
+        const size_t mask;
+        std::atomic<uint64_t>* entries;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::atomic<Table*> table;
+        size_t size = 0;
+
+        // Writers only (and ForEach()); outgrown tables are kept, as readers may still be in them
+        mutable std::mutex mutex;
+        std::vector<Table*> outgrown;
+    };
+
+    Shard shards[PLAYER_REGISTRY_SHARDS];
+
+    std::atomic<Player*> chunks[PLAYER_MAX_CHUNKS];
+    std::atomic<uint32_t> count;
+
+    Player* Get(const Handle handle) const
+    {
+        return chunks[handle >> PLAYER_CHUNK_BITS].load(std::memory_order_acquire) + (handle & (PLAYER_CHUNK_SIZE - 1));
+    }
+
+    Player* Find(const Table& table, const size_t hash, const std::string& name) const;
+    Player* Allocate(Player&& player, Handle& handle);
+    static void Insert(Table& table, const size_t hash, const uint64_t entry);
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include "Common.h"
+#include "Player.h"
+
+/*
+    Keeps players who've been gone a while on disk rather than in
+    memory. Each gets a small text file of their own in the player
+    directory (under the data directory), holding everything but their
+    name, with items stored by name (as hot restarts do) so that files
+    outlive changes to the item list.
+*/
+class PlayerStore
+{
+public:
+    // Writes the player out, then frees what they were holding onto (their inventory,
+    // aliases and any buffered output); false if they couldn't be written, leaving them be
+    static bool Hibernate(Player& player);
+
+    // Reads a hibernated player back in; false if their file's gone or unreadable,
+    // in which case they're left with only what stayed in memory
+    static bool Revive(Player& player);
+
+    // Throws away anything kept for the player
+    static void Forget(const Player& player);
+
+private:
+    static std::string GetPath(const std::string& name);
+};
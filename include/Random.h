@@ -0,0 +1,74 @@
+#pragma once
+#include "Common.h"
+
+/*
+    Counter-based random numbers. Each number is a hash (SplitMix64's
+    finaliser) of a key and a count, so a stream is nothing but those
+    two integers, each number costs a few multiplies, and no state is
+    shared with anybody. Streams belong to whatever owns them (a player,
+    for instance), so two threads never draw from the same one.
+
+    Whatever should come out the same every time, like the look of a
+    tile, needn't keep a stream at all: Hash() gives a number straight
+    from whatever identifies it.
+
+    World generation still goes through srand()/rand(), as that's what
+    decides the map a seed makes, and it all runs before any threads do.
+*/
+class Random
+{
+public:
+    Random(const uint64_t key = 0) : key(Mix(key)), counter(0) {}
+
+    // Mixes any number of integers into one
+    template<typename... T>
+    static uint64_t Hash(const T... values)
+    {
+        uint64_t hash = 0;
+        ((hash = Mix(hash ^ (uint64_t) values)), ...);
+        return hash;
+    }
+
+    // Where the stream's got to, so that it can carry on elsewhere (in a new
+    // process, say) rather than start over and repeat itself
+    uint64_t GetKey() const { return key; }
+    uint64_t GetCounter() const { return counter; }
+
+    static Random Resume(const uint64_t key, const uint64_t counter)
+    {
+        Random random;
+        random.key = key;
+        random.counter = counter;
+        return random;
+    }
+
+    uint64_t Next() { return Draw(key, counter++); }
+
+    // From 0 up to (but not including) the bound, without dividing
+    uint64_t Below(const uint64_t bound) { return (uint64_t) (((unsigned __int128) Next() * bound) >> 64); }
+
+    // From 0 up to (but not including) 1
+    float NextFloat() { return (Next() >> 40) * (1.0f / (1 << 24)); }
+
+    template<typename T>
+    const T& Pick(const std::vector<T>& list) { return list[Below(list.size())]; }
+
+    // The nth number of the stream with the given key, without keeping a stream (or
+    // of a stream per lane, given a vector of keys)
+    template<typename T>
+    static T Draw(const T key, const uint64_t n) { return Mix(key + n * 0x9e3779b97f4a7c15); }
+
+    // Scrambles every bit of a number into every other (or of each number in a vector)
+    template<typename T>
+    static T Mix(T x)
+    {
+        x += 0x9e3779b97f4a7c15;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        return x ^ (x >> 31);
+    }
+
+private:
+    uint64_t key;
+    uint64_t counter;
+};
@@ -0,0 +1,234 @@
+#pragma once
+#include "Common.h"
+#include "MpscQueue.h"
+#include "Output.h"
+#include "SpscRing.h"
+#include "Strand.h"
+#include "TimerWheel.h"
+
+#include <atomic>
+
+// Most commands a connection may have waiting on the simulation at once;
+// every command gets exactly one reply, so along with however many replies
+// nobody asked for (like the blows of a fight) may be waiting too, and a
+// last farewell, this also bounds each reply ring
+#define MAX_COMMANDS_IN_FLIGHT 16
+#define MAX_EVENTS_IN_FLIGHT 8
+#define REPLY_RING_SIZE 32
+
+class Connection;
+class EventLoop;
+class Player;
+struct Session;
+
+struct Reply
+{
+    enum Type
+    {
+        LoggedIn,   // Name accepted
+        Reconnected,// Name belonged to a player who'd left, and they're back
+        NameTaken,  // Name refused, so ask again
+        Resumed,    // Carried over from before a restart
+        Output,     // A command's output
+        Farewell    // Last words, after which the connection closes
+    };
+
+    Type type = Output;
+    std::string text;
+    std::vector<OutputSplice> splices;  // Shared text going out amongst the rest
+
+    // Sent without a command asking for it, so not one of those in flight
+    bool event = false;
+};
+
+struct Command
+{
+    enum Type
+    {
+        Login,      // Text is the name asked for
+        Line,       // Text is the command
+        Resume,     // Text is the name of a player carried over
+        Disconnect
+    };
+
+    Type type = Line;
+    std::shared_ptr<Session> session;
+    std::string text;
+    std::chrono::steady_clock::time_point posted;
+};
+
+/*
+    The meeting point of a connection and the simulation. Commands wait
+    in the session until a strand gets round to them, and replies go
+    back through a ring that only the simulation writes and only the
+    connection's event loop reads; either side may let go first.
+*/
+struct Session
+{
+    Session(EventLoop& loop) :
+        loop(loop), queued(false), events(0), connection(nullptr), scheduled(false), player(nullptr), strand(nullptr), arriving(false), fighting(false) {}
+
+    EventLoop& loop;
+    SpscRing<Reply, REPLY_RING_SIZE> replies;
+
+    // Set whilst the session's waiting in its loop's queue, so it's only there once
+    std::atomic<bool> queued;
+
+    // Replies sent without being asked for that the loop's yet to take
+    std::atomic<int> events;
+
+    // Only ever touched by the loop; null once the connection has gone
+    Connection* connection;
+
+    MpscQueue<Command> commands;
+
+    // Set whilst the session's posted to (or running on) a strand, so that
+    // its commands run on one strand at a time, in the order they were sent
+    std::atomic<bool> scheduled;
+
+    // Only touched by whichever strand's running the session: the player, once
+    // there is one, and the strand their area belongs to (or else the lobby's)
+    Player* player;
+    Strand* strand;
+
+    // Gone through a portal, with the rest of the command to run on the other side
+    bool arriving;
+
+    // A login (or resume) for a player who already exists, waiting on the lobby
+    std::optional<Command> claim;
+
+    // Counted amongst the fights in the player's area
+    bool fighting;
+};
+
+/*
+    Owns the game. Each area belongs to a strand of its own, and every
+    command runs on the strand of the area its player is in, so players
+    in different areas are served fully in parallel by a pool of workers
+    whilst nothing in the game needs locking. Moving through a portal
+    hands the session over to the strand on the other side. Connections
+    post commands from any event loop without blocking, and output goes
+    back without the simulation ever waiting on I/O.
+*/
+class Simulation
+{
+public:
+
+    static Simulation& Get()
+    {
+        // Guaranteed to be instantiated and destroyed by the compiler
+        static Simulation simulation;
+        return simulation;
+    }
+
+    Simulation(Simulation const&) = delete;
+    void operator=(Simulation const&) = delete;
+
+    // Once the game's loaded, as that's what decides the strands
+    void Start();
+
+    // Any thread
+    void Post(Command&& command);
+
+    // Any thread; runs a task on the area's strand once the delay (in milliseconds) is up
+    void Schedule(const uint64_t delay, const AreaID area, Strand::Task task);
+
+    // Blocks until everything posted so far has run, then holds the simulation
+    // still (so another thread may safely look at the game) until Resume()
+    void Pause();
+    void Resume();
+
+private:
+    Simulation();
+    ~Simulation();
+
+    struct Timer
+    {
+        uint64_t delay;
+        Strand* strand;
+        Strand::Task task;
+    };
+
+    // A player who's lost their session, and is kept for a while in case they
+    // come back; numbered, so a timer from an earlier absence can tell it's stale
+    struct Absence
+    {
+        uint64_t id;
+        bool evicted;   // Died, so they're gone for good, save for their name
+    };
+
+    // Everybody fighting in an area, only touched on its strand; whilst there's anybody,
+    // the area ticks, with each tick taking the next few fights on by one exchange
+    struct Battle
+    {
+        std::vector<std::shared_ptr<Session>> fighters;
+        size_t next = 0;
+        bool ticking = false;
+    };
+
+    // Time from being posted to having run, for reporting tick latency; each
+    // worker counts its own, so they never fight over a cache line
+    struct alignas(64) Latency
+    {
+        std::atomic<uint64_t> executed { 0 };
+        std::atomic<uint64_t> total { 0 };
+        std::atomic<uint64_t> max { 0 };
+    };
+
+    std::vector<std::unique_ptr<Strand>> strands;
+    std::vector<std::unique_ptr<Battle>> battles;
+    Strand lobby;
+    std::vector<std::unique_ptr<Latency>> latencies;
+
+    // Sessions without a player are spread over these (one to a worker), so that new
+    // names are claimed in parallel; only taking back an existing player needs the lobby
+    std::vector<std::unique_ptr<Strand>> gates;
+
+    // Players without a session belong to the lobby, and only it touches these
+    std::unordered_map<Player*, Absence> absent;
+    uint64_t absences;
+    uint64_t grace;
+
+    // Milliseconds between exchanges of blows, and the most fights an area takes on each tick
+    uint64_t combatTick;
+    size_t combatExchanges;
+
+    // Players in memory with a session, in memory without one, and on disk
+    std::atomic<size_t> connected;
+    std::atomic<size_t> waiting;
+    std::atomic<size_t> hibernated;
+
+    // Timers belong to the simulation's own thread, with any others asking for them
+    TimerWheel timers;
+    MpscQueue<Timer> pendingTimers;
+    int wakeFd;
+    std::atomic<bool> sleeping;
+    std::thread thread;
+
+    void Run();
+    void Schedule(const uint64_t delay, Strand& strand, Strand::Task task);
+    void Sleep(const int timeout);
+    void Wake();
+
+    Strand* GetGate(const Session& session) { return gates[std::hash<const Session*>()(&session) % gates.size()].get(); }
+
+    void Serve(const std::shared_ptr<Session>& session);
+    void Execute(const std::shared_ptr<Session>& session, Command& command);
+    void Arrive(const std::shared_ptr<Session>& session);
+
+    // On the area's strand; joins or leaves the area's fights, as the player now is or isn't in one
+    void Muster(const std::shared_ptr<Session>& session, const AreaID area);
+    void Tick(const AreaID area);
+
+    // Lobby only
+    bool Claim(Player& player);
+    void Detach(Player& player);
+    void Expire(Player& player, const uint64_t id);
+
+    void SendReply(const std::shared_ptr<Session>& session, const Reply::Type type, std::string&& text, const bool event = false);
+    void SendReply(const std::shared_ptr<Session>& session, const Reply::Type type, Output& output, const bool event);
+    void Deliver(const std::shared_ptr<Session>& session, Reply&& reply);
+    void SendOutput(const std::shared_ptr<Session>& session, const bool alive);
+    void SendEvent(const std::shared_ptr<Session>& session, const bool alive);
+    void Report(const int interval);
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include "Common.h"
+
+#include <atomic>
+#include <array>
+
+/*
+    Bounded lock-free ring for exactly one producer thread and one
+    consumer thread. Each side only ever writes its own index, so the
+    only sharing is the index the other side reads.
+*/
+template<typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    SpscRing(SpscRing const&) = delete;
+    void operator=(SpscRing const&) = delete;
+
+    // Producer only; false if full
+    bool Push(T&& value)
+    {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == Capacity) return false;
+
+        slots[position & (Capacity - 1)] = std::move(value);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only; false if empty
+    bool Pop(T& value)
+    {
+        const size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) return false;
+
+        value = std::move(slots[position & (Capacity - 1)]);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> slots;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include "Common.h"
+#include "MpscQueue.h"
+
+#include <atomic>
+
+// Most tasks a strand runs before giving its worker up to another strand
+#define STRAND_BATCH 64
+
+/*
+    A queue of tasks that run one after another, in the order they were
+    posted, on whichever of the pool's workers is free. A strand never runs
+    on two workers at once, so whatever belongs to it (each area belongs
+    to exactly one) needs no locking, while separate strands run fully
+    in parallel.
+*/
+class Strand
+{
+public:
+    typedef std::function<void()> Task;
+
+    Strand() : scheduled(false) {}
+    ~Strand() {}
+
+    Strand(Strand const&) = delete;
+    void operator=(Strand const&) = delete;
+
+    // Any thread
+    void Post(Task task);
+
+    // Workers only; runs up to a batch of tasks, then hands the strand
+    // back to be run again if there's anything left
+    void Run();
+
+private:
+    MpscQueue<Task> tasks;
+
+    // Set whilst the strand's waiting to run or running, so that only one
+    // worker ever has it
+    std::atomic<bool> scheduled;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include "Common.h"
+
+/*
+    Just enough of the telnet protocol to pick option negotiation out
+    of a client's input. Commands may be split across reads, so the
+    parser carries its state over from one call to the next.
+*/
+class Telnet
+{
+public:
+
+    enum Command : unsigned char
+    {
+        SE   = 240,
+        SB   = 250,
+        WILL = 251,
+        WONT = 252,
+        DO   = 253,
+        DONT = 254,
+        IAC  = 255
+    };
+
+    enum Option : unsigned char
+    {
+        Compress2 = 86 // MCCP2
+    };
+
+    struct Negotiation
+    {
+        Command command;
+        unsigned char option;
+    };
+
+    Telnet() : state(State::Data) {}
+    ~Telnet() {}
+
+    // Whether the next byte belongs to a command rather than to the player
+    bool IsCommand(const char byte) const { return state != State::Data || (unsigned char) byte == IAC; }
+
+    // Consumes a command's bytes, stopping early once a negotiation completes
+    // (which is written to negotiation) or the command does
+    size_t Parse(const char* data, const size_t size, std::optional<Negotiation>& negotiation);
+
+    static std::string MakeCommand(const Command command, const unsigned char option);
+
+private:
+    enum class State
+    {
+        Data,
+        Iac,
+        Negotiate,
+        Subnegotiation,
+        SubnegotiationIac
+    };
+
+    State state;
+    Command pending;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include "Common.h"
+
+#include <chrono>
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+
+typedef uint64_t TimerID;
+
+/*
+    Hierarchical timer wheel: scheduling, cancelling and firing are all
+    O(1), however many timers are pending. Each level's slots cover 64
+    times the span of the level below, and timers are cascaded down a
+    level as their time draws near. With four levels of 64 slots, a
+    wheel ticking every 50ms reaches out to a little over nine days.
+
+    Not thread-safe; a wheel belongs to whichever thread advances it.
+*/
+class TimerWheel
+{
+public:
+    typedef std::function<void()> Callback;
+
+    TimerWheel(const unsigned int tickMs);
+    ~TimerWheel() {}
+
+    TimerWheel(TimerWheel const&) = delete;
+    void operator=(TimerWheel const&) = delete;
+
+    TimerID Schedule(const uint64_t delayMs, Callback callback);
+    void Cancel(const TimerID id);
+
+    // Fires everything that's come due since the last call
+    void Advance();
+
+    // Milliseconds until there might be something to fire, or -1 if never
+    int GetTimeout() const;
+
+    // Milliseconds since the wheel was made
+    uint64_t Now() const;
+
+    size_t Size() const { return count; }
+
+private:
+    struct Timer
+    {
+        Callback callback;
+        uint64_t expiry;        // In ticks
+        uint32_t generation;    // Bumped on reuse, so stale IDs can be spotted
+        int32_t previous;
+        int32_t next;
+        int32_t slot;           // -1 when not in any slot
+    };
+
+    const unsigned int tickMs;
+    const std::chrono::steady_clock::time_point start;
+    uint64_t currentTick;
+    size_t count;
+
+    std::vector<Timer> timers;
+    std::vector<int32_t> freeTimers;
+    int32_t slots[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+
+    void Insert(const int32_t index);
+    void Unlink(const int32_t index);
+    void Release(const int32_t index);
+    void Cascade(const int level);
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include "Common.h"
+
+// Most arguments a command may have after its verb
+#define MAX_ARGUMENTS 8
+
+struct Token
+{
+    enum Type
+    {
+        Number,     // All digits, e.g. 3
+        Count,      // An x then digits, e.g. x5
+        Word,       // Anything else without spaces
+        Text        // Anything between double quotes, spaces and all
+    };
+
+    Type type = Word;
+
+    // As typed, less any quotes; points into the line
+    std::string_view text;
+
+    // Numbers and counts only
+    int number = 0;
+};
+
+/*
+    Splits a command into its verb and typed arguments, on spaces and
+    tabs. Tokens are views into the line, kept in a fixed array, so
+    nothing is copied or allocated, but the line has to outlive them.
+    A number or count too big for an int is taken as a word.
+*/
+class Tokenizer
+{
+public:
+    Tokenizer(std::string_view line);
+
+    // False for an unclosed quote, or too many arguments
+    bool IsValid() const { return valid; }
+
+    // Empty if the line was
+    std::string_view GetVerb() const { return verb; }
+
+    size_t GetArgumentCount() const { return count; }
+    const Token& GetArgument(const size_t i) const { return arguments[i]; }
+
+    // Only if there's an argument there, and it's of that type
+    std::optional<int> GetNumber(const size_t i) const { return GetInt(i, Token::Number); }
+    std::optional<int> GetCount(const size_t i) const { return GetInt(i, Token::Count); }
+    std::optional<std::string_view> GetText(const size_t i) const;
+
+private:
+    std::string_view verb;
+    Token arguments[MAX_ARGUMENTS];
+    size_t count;
+    bool valid;
+
+    std::optional<int> GetInt(const size_t i, const Token::Type type) const;
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include "Common.h"
+#include "EventLoop.h"
+
+#ifdef SLUDGE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+/*
+    Completion-based backend built directly on the io_uring system
+    calls. A single multishot accept and one multishot receive per
+    client stay armed for as long as they're needed, with received
+    data landing in a kernel-managed ring of provided buffers (or,
+    where that ring doesn't work, buffers provided one at a time),
+    and every send queued in an iteration goes out in one submission.
+*/
+class UringLoop : public EventLoop
+{
+public:
+    UringLoop(int serverFd);
+    ~UringLoop();
+
+    // False if the kernel lacks anything we rely on
+    bool Initialise();
+    void Run() override;
+
+    std::vector<Connection::Snapshot> Save() override;
+    void Adopt(const Connection::Snapshot& snapshot) override;
+
+private:
+
+    enum Operation : uint64_t
+    {
+        Accept,
+        Receive,
+        Send,
+        Provide,
+        Cancel,
+        Probe,
+        Stop,
+        Wake
+    };
+
+    struct Client
+    {
+        bool receiving = false;
+        bool sending = false;
+        bool cancelling = false;
+        bool shutdown = false;
+
+        std::string stash;
+
+        msghdr message;
+        iovec vectors[MAX_OUTPUT_VECTORS];
+    };
+
+    int ringFd;
+
+    // Submission queue
+    void* submissionRing;
+    size_t submissionRingSize;
+    unsigned* submissionHead;
+    unsigned* submissionTail;
+    unsigned submissionMask;
+    unsigned* submissionArray;
+    io_uring_sqe* submissionEntries;
+    size_t submissionEntriesSize;
+    unsigned localTail;
+    unsigned pending;
+
+    // Completion queue
+    void* completionRing;
+    size_t completionRingSize;
+    unsigned* completionHead;
+    unsigned* completionTail;
+    unsigned completionMask;
+    io_uring_cqe* completionEntries;
+
+    // Provided receive buffers
+    io_uring_buf_ring* bufferRing;
+    size_t bufferRingSize;
+    char* buffers;
+    bool useBufferRing;
+
+    // Node-based, so each client's message stays put whilst a send is in flight
+    std::unordered_map<int, Client> clients;
+
+    // Once stopping, nothing new is started, and Run() returns once everything
+    // in flight has completed or been cancelled
+    bool accepting;
+    bool stopping;
+    bool waking;
+
+    io_uring_sqe* GetSubmission();
+    int Submit(const unsigned waitFor, const int timeout = -1);
+    void ProvideBuffer(const unsigned short id);
+    bool ProbeBufferRing();
+
+    void ArmAccept();
+    void ArmStop();
+    void ArmWake();
+    void OnStop();
+    bool IsIdle() const;
+
+    void ArmReceive(const int fd);
+    void UpdateReceive(const int fd);
+    void QueueSends();
+    void CancelRequest(const uint64_t userData, const int fd);
+
+    void OnCompletion(const io_uring_cqe& completion);
+    void OnAccept(const io_uring_cqe& completion);
+    void OnReceive(const int fd, const io_uring_cqe& completion);
+    void OnSend(const int fd, const io_uring_cqe& completion);
+    void OnUnblocked(Connection& connection) override;
+
+    void Retire(const int fd);
+};
+
+#endif
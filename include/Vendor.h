@@ -1,6 +1,7 @@
 #pragma once
 #include "Common.h"
 #include "Item.h"
+#include "ItemTable.h"
 
 class Vendor
 {
@@ -18,10 +19,13 @@ public:
     Vendor(const Type type);
     ~Vendor();
 
-    void AddItem(ItemID itemID);
+    void AddItem(ItemID itemID, unsigned int number = 1);
     void RemoveItem(size_t vectorIndex);
 
     static std::vector<std::string> names;
     std::vector<ItemStack> items;
     std::string name;
+
+    // Redrawn only once AddItem() or RemoveItem() has changed what's for sale
+    ItemTable table;
 };
\ No newline at end of file
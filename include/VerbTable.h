@@ -0,0 +1,97 @@
+#pragma once
+#include "Common.h"
+
+/*
+    A command's first word, along with what it expects after it and the
+    handler it runs. Handlers are whatever the table's user needs them
+    to be (in practice, a pointer to a member function).
+*/
+template<typename Handler>
+struct Verb
+{
+    enum Argument
+    {
+        None,       // Anything after the verb is left to the handler
+        Optional,   // The first argument may be a number
+        Required    // The first argument must be a number, or it's invalid
+    };
+
+    std::string_view name;
+    Argument argument = None;
+    Handler handler = nullptr;
+
+    // For help; what the argument stands for (if anything) and what the verb does
+    std::string_view usage;
+    std::string_view description;
+};
+
+/*
+    Every verb, put together at compile time into a perfect hash: the
+    constructor tries seeds until one gives each verb a slot of its own,
+    so finding a verb is one hash, one lookup and one comparison, without
+    probing or allocating. A list of verbs no seed will separate (or with
+    a name given twice) fails to compile. Iterating goes through verbs in
+    the order given, as help lists them.
+*/
+template<typename Handler, size_t N>
+class VerbTable
+{
+    static_assert(N < 255, "Slots hold verbs' indices in a byte");
+
+public:
+    // Comfortably over twice as many slots as verbs, so a seed is soon found
+    static constexpr size_t Slots = [] { size_t slots = 1; while (slots < N * 2) slots *= 2; return slots; }();
+
+    constexpr VerbTable(const Verb<Handler> (&list)[N]) : verbs(), slots(), seed(0)
+    {
+        for (size_t i = 0; i < N; ++i) verbs[i] = list[i];
+
+        for (;; ++seed)
+        {
+            if (seed == 1 << 16) throw "No seed gives every verb a slot of its own";
+
+            for (size_t i = 0; i < Slots; ++i) slots[i] = 0;
+
+            bool collided = false;
+            for (size_t i = 0; i < N && !collided; ++i)
+            {
+                const size_t slot = Hash(verbs[i].name, seed);
+                if (slots[slot] != 0) collided = true;
+                else slots[slot] = i + 1;
+            }
+
+            if (!collided) break;
+        }
+    }
+
+    // Null if there's no such verb
+    constexpr const Verb<Handler>* Find(const std::string_view name) const
+    {
+        const size_t index = slots[Hash(name, seed)];
+        if (index == 0 || verbs[index - 1].name != name) return nullptr;
+        return &verbs[index - 1];
+    }
+
+    constexpr const Verb<Handler>* begin() const { return verbs; }
+    constexpr const Verb<Handler>* end() const { return verbs + N; }
+
+private:
+    // FNV-1a, started from the seed, with the high bits folded down into the slot
+    static constexpr size_t Hash(const std::string_view name, const uint32_t seed)
+    {
+        uint32_t hash = 2166136261u ^ seed;
+        for (const char c : name)
+        {
+            hash ^= (unsigned char) c;
+            hash *= 16777619u;
+        }
+
+        return (hash ^ (hash >> 16)) & (Slots - 1);
+    }
+
+    Verb<Handler> verbs[N];
+
+    // The index of each slot's verb, plus one, or 0 if the slot's empty
+    uint8_t slots[Slots];
+    uint32_t seed;
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include "Common.h"
+
+#include <atomic>
+
+/*
+    Chase-Lev work-stealing deque (in the C11 form given by Lê et al.).
+    The owning thread pushes and pops at the bottom without ever taking
+    a lock, and only has to compare-and-swap when it's down to its last
+    item; any other thread may steal from the top. Grows as needed, and
+    as thieves may still be reading an outgrown array, those are kept
+    until the deque goes.
+
+    Items are read and written atomically, so T must be trivially
+    copyable (in practice, a pointer).
+*/
+template<typename T>
+class WorkStealingDeque
+{
+public:
+    WorkStealingDeque(const size_t capacity = 256) : top(0), bottom(0), array(new Array(capacity)) {}
+
+    ~WorkStealingDeque()
+    {
+        delete array.load();
+        for (Array* retired : outgrown) delete retired;
+    }
+
+    WorkStealingDeque(WorkStealingDeque const&) = delete;
+    void operator=(WorkStealingDeque const&) = delete;
+
+    // Owner only
+    void Push(T item)
+    {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+
+        if (b - t > (int64_t) a->capacity - 1) a = Grow(a, t, b);
+
+        // Publishing the item along with the new bottom
+        a->Put(b, item);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only; takes the most recently pushed item
+    bool Pop(T& item)
+    {
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = a->Get(b);
+        if (t < b) return true;
+
+        // Last one, so we race any thieves for it
+        const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    // Any thread; takes the oldest item, and may fail spuriously under contention
+    bool Steal(T& item)
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+
+        Array* a = array.load(std::memory_order_acquire);
+        item = a->Get(t);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // Any thread, though only a hint for any but the owner
+    bool Empty() const
+    {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+private:
+    struct Array
+    {
+        Array(const size_t capacity) : capacity(capacity), mask(capacity - 1), items(new std::atomic<T>[capacity]) {}
+        ~Array() { delete[] items; }
+
+        T Get(const int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+        void Put(const int64_t i, T item) { items[i & mask].store(item, std::memory_order_relaxed); }
+
+        const size_t capacity;
+        const size_t mask;
+        std::atomic<T>* items;
+    };
+
+    Array* Grow(Array* old, const int64_t t, const int64_t b)
+    {
+        Array* grown = new Array(old->capacity * 2);
+        for (int64_t i = t; i < b; ++i) grown->Put(i, old->Get(i));
+
+        outgrown.push_back(old);
+        array.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+    // Thieves and the owner each keep to their own cache line
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Array*> array;
+    std::vector<Array*> outgrown;
+};
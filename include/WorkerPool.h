@@ -0,0 +1,102 @@
+#pragma once
+#include "Common.h"
+#include "WorkStealingDeque.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+
+/*
+    The threads behind everything the game does in parallel: area
+    strands, and batch jobs such as laying the world's paths. Each
+    worker keeps a deque of its own, where whatever it submits goes;
+    once that's empty it takes from the shared queue (where everyone
+    else's submissions go), and failing that steals from the others.
+    An idle worker keeps looking for a little while before parking,
+    so bursts of work don't pay for waking it up.
+*/
+class WorkerPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    struct Counters
+    {
+        uint64_t executed;  // Tasks run
+        uint64_t stolen;    // Of those, how many were taken from another worker
+        uint64_t parked;    // Times the worker ran out of things to do and slept
+    };
+
+    static WorkerPool& Get()
+    {
+        // Guaranteed to be instantiated and destroyed by the compiler
+        static WorkerPool pool;
+        return pool;
+    }
+
+    WorkerPool(WorkerPool const&) = delete;
+    void operator=(WorkerPool const&) = delete;
+
+    // Any thread; workers keep what they submit for themselves, unless stolen
+    void Submit(Task task);
+
+    // Any thread; to the back of the shared queue, behind everybody else, for
+    // tasks giving way to others
+    void Defer(Task task);
+
+    // Not from a worker; returns once every task has run
+    void Run(std::vector<Task> tasks);
+
+    // Blocks until nothing's left to run, then holds every worker still (with
+    // anything submitted meanwhile left waiting) until Resume()
+    void Pause();
+    void Resume();
+
+    size_t Size() const { return workers.size(); }
+
+    // Which worker this is, from 0, or -1 if it's not one of ours
+    static int GetWorkerIndex();
+
+    // Counts since the last call
+    std::vector<Counters> TakeCounters();
+
+private:
+    WorkerPool();
+    ~WorkerPool();
+
+    struct alignas(64) Worker
+    {
+        WorkStealingDeque<Task*> tasks;
+        std::thread thread;
+
+        std::atomic<uint64_t> executed { 0 };
+        std::atomic<uint64_t> stolen { 0 };
+        std::atomic<uint64_t> parked { 0 };
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::chrono::microseconds spin;
+
+    // Submitted from outside the pool (or deferred)
+    std::deque<Task*> shared;
+    std::mutex sharedMutex;
+    std::atomic<size_t> sharedSize;
+
+    // Tasks submitted but not yet finished, and workers looking for or running one
+    std::atomic<size_t> outstanding;
+    std::atomic<unsigned int> running;
+
+    std::mutex parkMutex;
+    std::condition_variable parkChanged;
+    std::condition_variable idle;
+    std::atomic<unsigned int> sleepers;
+    std::atomic<bool> pausing;
+    std::atomic<bool> paused;
+
+    void Work(const size_t index);
+    Task* Find(const size_t index);
+    bool HasWork() const;
+    void Push(Task* task, const bool deferred);
+    void WakeOne();
+    void Finished();
+};
@@ -2,6 +2,15 @@
 #include "Common.h"
 #include "Area.h"
 
+// Cells shown either side of the player on their map, across and down
+#define VIEW_RADIUS_X 4
+#define VIEW_RADIUS_Y 1
+#define VIEW_COLUMNS (VIEW_RADIUS_X * 2 + 1)
+#define VIEW_ROWS (VIEW_RADIUS_Y * 2 + 1)
+
+// Screen rows kept for a pinned map: its edges, its rows and a gap under it
+#define PINNED_MAP_LINES (VIEW_ROWS + 3)
+
 class World : public Area
 {
 public:
@@ -31,7 +40,18 @@ private:
     int width;
     int height;
 
-    void CreatePath(const Cell startCell, const Cell endCell);
+    // The whole world as players see it, portals and all, with a border of
+    // nothing around it as deep as a view reaches, so any view is a slice of
+    // each of a few rows
+    std::vector<char> plane;
+    int planeWidth;
+
+    void Bake();
+    void DrawPinned(Player& player, const char (&view)[VIEW_ROWS][VIEW_COLUMNS]) const;
+
+    // Returns the cells making up a path between the two; only reads the
+    // world, so several may be worked out at once
+    std::vector<Cell> CreatePath(const Cell startCell, const Cell endCell) const;
 
     Tile GetTile(Cell cell) const;
     Tile GetTile(const int x, const int y) const;
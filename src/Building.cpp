@@ -114,12 +114,14 @@ Cell Building::GetStartingCell() const { return 0; }
 void Building::Look(Player& player) const
 {
     player << "You are in a building.\n";
-    srand(seed * 10000 + player.cell);
+
+    // Seeded by tile, so each always looks the same
+    Random random(Random::Hash(seed, player.cell));
 
     // Descriptions
-    const std::string& furniture = grand ? grandFurniture[rand() % grandFurniture.size()] : humbleFurniture[rand() % humbleFurniture.size()];
-    const std::string& floors = grand ? grandFloors[rand() % grandFloors.size()] : humbleFloors[rand() % humbleFloors.size()];
-    const std::string& walls = grand ? grandWalls[rand() % grandWalls.size()] : humbleWalls[rand() % humbleWalls.size()];
+    const std::string& furniture = grand ? random.Pick(grandFurniture) : random.Pick(humbleFurniture);
+    const std::string& floors = grand ? random.Pick(grandFloors) : random.Pick(humbleFloors);
+    const std::string& walls = grand ? random.Pick(grandWalls) : random.Pick(humbleWalls);
 
     player << "- " << walls << "\n";
     player << "- " << furniture << "\n";
@@ -129,23 +131,23 @@ void Building::Look(Player& player) const
     switch (type)
     {
         case Tavern:
-            player << "- " << tavernFurniture[rand() % tavernFurniture.size()] << "\n";
+            player << "- " << random.Pick(tavernFurniture) << "\n";
         break;
 
         case Food:
-            player << "- " << foodFurniture[rand() % foodFurniture.size()] << "\n";
+            player << "- " << random.Pick(foodFurniture) << "\n";
         break;
 
         case Weapons:
-            player << "- " << weaponFurniture[rand() % weaponFurniture.size()] << "\n";
+            player << "- " << random.Pick(weaponFurniture) << "\n";
         break;
 
         case Armour:
-            player << "- " << armourFurniture[rand() % armourFurniture.size()] << "\n";
+            player << "- " << random.Pick(armourFurniture) << "\n";
         break;
 
         case Home:
-            player << "- " << homeFurniture[rand() % homeFurniture.size()] << "\n";
+            player << "- " << random.Pick(homeFurniture) << "\n";
         break;
 
         default:
@@ -99,14 +99,14 @@ void Cave::Look(Player& player) const
         player << "- You see a crack of light eminating from a crevice - the way out is here...\n";
 
     // Pick seed for tile then display some random descriptions
-    srand(seed * 10000 + player.cell);
+    Random random(Random::Hash(seed, player.cell));
     std::set<size_t> usedIndexes;
     for (size_t i = 0; i < numDescriptions; ++i)
     {
         // Chose *unique* index
-        size_t index = rand() % descriptions.size();
+        size_t index = random.Below(descriptions.size());
         while (usedIndexes.count(index))
-            index = rand() % descriptions.size();
+            index = random.Below(descriptions.size());
 
         player << "- " << descriptions[index] << "\n";
         usedIndexes.insert(index);
@@ -0,0 +1,61 @@
+#include "Compressor.h"
+
+#define CHUNK_SIZE 8192
+
+Compressor::Compressor(const int level, const int windowBits, const int memoryLevel) : pending(false)
+{
+    stream = {};
+    valid = deflateInit2(&stream, level, Z_DEFLATED, windowBits, memoryLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+    if (!valid) std::cerr << "Unable to start compression: " << (stream.msg ? stream.msg : "bad settings") << std::endl;
+}
+
+void Compressor::Compress(std::string_view string, OutputQueue& output)
+{
+    if (string.empty()) return;
+
+    stream.next_in = (Bytef*) string.data();
+    stream.avail_in = string.size();
+    Deflate(Z_NO_FLUSH, output);
+    pending = true;
+}
+
+void Compressor::Flush(OutputQueue& output)
+{
+    if (!pending) return;
+
+    Deflate(Z_SYNC_FLUSH, output);
+    pending = false;
+}
+
+void Compressor::Finish(OutputQueue& output)
+{
+    Deflate(Z_FINISH, output);
+    pending = false;
+}
+
+void Compressor::Deflate(const int flush, OutputQueue& output)
+{
+    // Keep going until zlib has input left over and room to spare, as only then
+    // can we be sure everything asked for has been written out
+    char chunk[CHUNK_SIZE];
+    do
+    {
+        stream.next_out = (Bytef*) chunk;
+        stream.avail_out = sizeof(chunk);
+
+        const int result = deflate(&stream, flush);
+        if (result == Z_STREAM_ERROR)
+        {
+            std::cerr << "Compression stream error" << std::endl;
+            return;
+        }
+
+        output.Append(std::string_view(chunk, sizeof(chunk) - stream.avail_out));
+    }
+    while (stream.avail_out == 0 || stream.avail_in > 0);
+}
+
+Compressor::~Compressor()
+{
+    deflateEnd(&stream);
+}
@@ -0,0 +1,68 @@
+#include "Config.h"
+
+Config::Config()
+{
+    for (const auto& line : ReadLines("config.txt"))
+    {
+        // Skip blank lines and comments
+        const size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        const size_t equals = line.find('=');
+        if (equals == std::string::npos)
+        {
+            std::cerr << "Ignoring malformed config line: " << line << std::endl;
+            continue;
+        }
+
+        Set(line.substr(0, equals), line.substr(equals + 1));
+    }
+}
+
+void Config::ParseArguments(const int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        const size_t equals = argument.find('=');
+
+        if (argument.rfind("--", 0) != 0 || equals == std::string::npos)
+        {
+            std::cerr << "Ignoring unknown argument " << argument << std::endl;
+            continue;
+        }
+
+        Set(argument.substr(2, equals - 2), argument.substr(equals + 1));
+    }
+}
+
+void Config::Set(const std::string& key, const std::string& value)
+{
+    const auto Trim = [](const std::string& string)
+    {
+        const size_t start = string.find_first_not_of(" \t\r");
+        const size_t end = string.find_last_not_of(" \t\r");
+        if (start == std::string::npos) return std::string();
+        return string.substr(start, end - start + 1);
+    };
+
+    values[Trim(key)] = Trim(value);
+}
+
+std::string Config::GetString(const std::string& key, const std::string& fallback) const
+{
+    if (!values.count(key)) return fallback;
+    return values.at(key);
+}
+
+int Config::GetInt(const std::string& key, const int fallback) const
+{
+    if (!values.count(key)) return fallback;
+
+    try { return std::stoi(values.at(key)); }
+    catch (const std::exception&)
+    {
+        std::cerr << "Config value for " << key << " is not a number" << std::endl;
+        return fallback;
+    }
+}
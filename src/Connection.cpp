@@ -1,93 +1,481 @@
 #include "Connection.h"
 #include "Game.h"
+#include "Config.h"
+#include "EventLoop.h"
+#include "Simulation.h"
 
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 
-#define BUFFER_SIZE 128
+struct OutputLimits
+{
+    size_t highWatermark;   // Stop reading commands at this much output...
+    size_t lowWatermark;    // ...until it's back down to this much
+    size_t limit;           // Past this, give up on the client one way or another
+    bool disconnect;        // Either disconnect, or drop what's not been sent
+};
+
+struct Timeouts
+{
+    uint64_t login;     // To choose a name
+    uint64_t idle;      // Between commands, once playing
+    uint64_t stall;     // Spent above the high watermark without catching up
+};
+
+struct CompressionSettings
+{
+    bool enabled;
+    int level;          // 1 (fastest) to 9 (smallest)
+    int windowBits;     // 8 to 15; each stream costs roughly 2^(windowBits+2) +
+    int memoryLevel;    // 2^(memoryLevel+9) bytes, on top of the output itself
+};
 
-Connection::Connection(int clientFd, const std::string address)
+static const CompressionSettings& GetCompressionSettings()
 {
-    bool alive = true;
+    static const CompressionSettings settings = []()
+    {
+        CompressionSettings settings =
+        {
+            Config::Get().GetInt("compression", 1) != 0,
+            Config::Get().GetInt("compression_level", 6),
+            Config::Get().GetInt("compression_window_bits", 13),
+            Config::Get().GetInt("compression_memory_level", 6)
+        };
+
+        // Anything zlib would refuse means never offering compression at all, rather
+        // than agreeing to it and then having no stream to send
+        if (settings.enabled && (settings.level < 1 || settings.level > 9 ||
+            settings.windowBits < 8 || settings.windowBits > 15 ||
+            settings.memoryLevel < 1 || settings.memoryLevel > 9))
+        {
+            std::cerr << "Invalid compression settings; compression is off" << std::endl;
+            settings.enabled = false;
+        }
+
+        return settings;
+    }();
+
+    return settings;
+}
+
+static const Timeouts& GetTimeouts()
+{
+    // Configured in seconds, kept in milliseconds
+    static const Timeouts timeouts =
+    {
+        (uint64_t) Config::Get().GetInt("login_timeout", 120) * 1000,
+        (uint64_t) Config::Get().GetInt("idle_timeout", 30 * 60) * 1000,
+        (uint64_t) Config::Get().GetInt("slow_client_timeout", 60) * 1000
+    };
+
+    return timeouts;
+}
 
-    const auto Send = [&](const std::string& string)
+static const OutputLimits& GetOutputLimits()
+{
+    static const OutputLimits limits =
     {
-        #ifdef __APPLE__
-            send(clientFd, string.c_str(), string.size(), 0);
-        #else
-            send(clientFd, string.c_str(), string.size(), MSG_NOSIGNAL);
-        #endif
+        (size_t) Config::Get().GetInt("output_high_watermark", 64 * 1024),
+        (size_t) Config::Get().GetInt("output_low_watermark", 16 * 1024),
+        (size_t) Config::Get().GetInt("output_limit", 1024 * 1024),
+        Config::Get().GetString("slow_client_policy", "disconnect") != "drop"
     };
 
-    const auto Read = [&](const std::string& prompt = "")
+    return limits;
+}
+
+Connection::Connection(int clientFd, const std::string& address, EventLoop& loop) :
+    fd(clientFd), address(address), loop(loop), state(State::Naming), paused(false), inFlight(0),
+    session(std::make_shared<Session>(loop)), idleTimer(0), stallTimer(0), lastActive(0)
+{
+    session->connection = this;
+    loginTimer = loop.GetTimers().Schedule(GetTimeouts().login, [this]() { OnLoginTimeout(); });
+
+    // Offer compression first, so a client that wants it can start as soon as possible
+    OfferCompression();
+
+    // Send motd and ask for a name; the answer arrives later as a read event
+    Send(Game::Get().motd);
+    Send("What is to be your name? ");
+}
+
+Connection::Connection(const Snapshot& snapshot, EventLoop& loop) :
+    fd(snapshot.fd), address(snapshot.address), loop(loop), state(snapshot.state), playerName(snapshot.player),
+    paused(false), inFlight(0), session(std::make_shared<Session>(loop)),
+    loginTimer(0), idleTimer(0), stallTimer(0), lastActive(loop.GetTimers().Now())
+{
+    session->connection = this;
+
+    // Timeouts start afresh, rather than anybody being cut off for the restart
+    if (state == State::Naming)
+        loginTimer = loop.GetTimers().Schedule(GetTimeouts().login, [this]() { OnLoginTimeout(); });
+
+    else if (state == State::Playing)
+    {
+        // Commands that follow only run once the simulation has found the player
+        Post(Command::Resume, playerName);
+        idleTimer = loop.GetTimers().Schedule(GetTimeouts().idle, [this]() { OnIdleTimeout(); });
+    }
+
+    // Whatever the old process hadn't sent yet goes first (including the end of
+    // any compressed stream), so the client sees nothing amiss
+    Send(std::string(snapshot.output));
+    if (snapshot.compressed) OfferCompression();
+    CheckOutput();
+
+    input.Append(snapshot.input.data(), snapshot.input.size());
+    ProcessInput();
+}
+
+Connection::Snapshot Connection::Save()
+{
+    // The simulation's finished with everything by now, so take its last replies
+    // (but don't send it anything more)
+    Reply reply;
+    while (session->replies.Pop(reply))
+        OnReply(reply);
+
+    Snapshot snapshot;
+    snapshot.fd = fd;
+    snapshot.address = address;
+    snapshot.state = state;
+    snapshot.compressed = compressor != nullptr;
+
+    if (compressor)
     {
-        if (prompt != "") Send(prompt);
+        compressor->Finish(output);
+        compressor.reset();
+    }
+
+    snapshot.player = playerName;
+    snapshot.input = input.Contents();
+    snapshot.output = output.Contents();
+    return snapshot;
+}
+
+void Connection::CheckSettings()
+{
+    GetCompressionSettings();
+    GetTimeouts();
+    GetOutputLimits();
+}
+
+void Connection::OfferCompression()
+{
+    if (GetCompressionSettings().enabled)
+        Send(Telnet::MakeCommand(Telnet::WILL, Telnet::Compress2));
+}
+
+size_t Connection::OnReceive(const char* data, const size_t size)
+{
+    if (!IsReading()) return size;
+
+    size_t taken = 0;
+    while (taken < size && WantsInput())
+    {
+        // Telnet commands are dealt with straight away, never reaching the game
+        if (telnet.IsCommand(data[taken]))
+        {
+            std::optional<Telnet::Negotiation> negotiation;
+            taken += telnet.Parse(data + taken, size - taken, negotiation);
+            if (negotiation.has_value()) OnNegotiation(negotiation.value());
+            continue;
+        }
+
+        // Otherwise take everything up until the next command
+        const char* command = (const char*) memchr(data + taken, Telnet::IAC, size - taken);
+        const size_t length = command ? command - (data + taken) : size - taken;
+        const size_t appended = input.Append(data + taken, length);
+        taken += appended;
+
+        // Passing those commands on may well make room for the rest, but if it
+        // doesn't, the rest has to wait for replies
+        const size_t space = input.Free();
+        ProcessInput();
+        if (appended < length && input.Free() == space) break;
+    }
 
-        // Read data into (null terminated) buffer, cutting off messages that're too long
-        char buffer[BUFFER_SIZE] = {};
-        ssize_t bytes = read(clientFd, buffer, sizeof(buffer));
+    return taken;
+}
 
-        if (bytes < 0)
+void Connection::OnNegotiation(const Telnet::Negotiation& negotiation)
+{
+    if (negotiation.option == Telnet::Compress2)
+    {
+        if (negotiation.command == Telnet::DO && !compressor && GetCompressionSettings().enabled)
         {
-            perror("Unable to read client socket");
-            alive = false;
-            return std::string();
+            // The stream has to exist before the client's told it's coming, and if
+            // it can't be had after all, the offer's withdrawn
+            const auto& settings = GetCompressionSettings();
+            auto started = std::make_unique<Compressor>(settings.level, settings.windowBits, settings.memoryLevel);
+            if (!started->IsValid())
+            {
+                Send(Telnet::MakeCommand(Telnet::WONT, Telnet::Compress2));
+                return;
+            }
+
+            // Everything after this subnegotiation is part of the compressed stream
+            const char start[] = { (char) Telnet::IAC, (char) Telnet::SB, (char) Telnet::Compress2, (char) Telnet::IAC, (char) Telnet::SE };
+            Send(std::string_view(start, sizeof(start)));
+            compressor = std::move(started);
         }
 
-        else if (bytes == 0)
+        else if (negotiation.command == Telnet::DONT && compressor)
         {
-            // Connection closed
-            alive = false;
-            return std::string();
+            // End the stream cleanly; the client carries on uncompressed from there
+            compressor->Finish(output);
+            compressor.reset();
         }
-        
-        // Remove newline and return
-        auto string = std::string(buffer);
-        string.erase(std::remove(string.begin(), string.end(), '\n'), string.end());
-        return string;
-    };
 
-    // Send motd
-    send(clientFd, Game::Get().motd.c_str(), Game::Get().motd.size(), 0);
+        return;
+    }
+
+    // Politely refuse anything else a client asks of us (but never respond to
+    // refusals, as that's how negotiation loops start)
+    if (negotiation.command == Telnet::DO) Send(Telnet::MakeCommand(Telnet::WONT, negotiation.option));
+    else if (negotiation.command == Telnet::WILL) Send(Telnet::MakeCommand(Telnet::DONT, negotiation.option));
+}
+
+void Connection::ProcessInput()
+{
+    // One read may well carry several commands, so pass on every complete one (unless
+    // output starts backing up, or the simulation has enough to be getting on with,
+    // in which case they wait their turn); a name has to be settled before anything else
+    const int limit = state == State::Naming ? 1 : MAX_COMMANDS_IN_FLIGHT;
+
+    std::string line;
+    while (IsRunning() && inFlight < limit && input.Pop(line))
+        OnLine(line);
+}
+
+void Connection::OnHangup()
+{
+    state = State::Closed;
+}
+
+void Connection::OnLine(const std::string& line)
+{
+    if (state == State::Naming) Post(Command::Login, line);
+
+    else if (state == State::Playing)
+    {
+        lastActive = loop.GetTimers().Now();
+        Post(Command::Line, line);
+    }
+}
+
+void Connection::Post(const Command::Type type, const std::string& text)
+{
+    Command command;
+    command.type = type;
+    command.session = session;
+    command.text = text;
+    Simulation::Get().Post(std::move(command));
+
+    if (type != Command::Disconnect) inFlight++;
+}
+
+void Connection::OnReplies()
+{
+    Reply reply;
+    while (session->replies.Pop(reply))
+        OnReply(reply);
+
+    // Replies make room for any commands that were held back
+    ProcessInput();
+}
 
-    // Get name
-    std::string name = Read("What is to be your name? ");
-    if (!alive) goto terminate;
-    
-    Player* player;
-    player = Game::Get().AddPlayer(name);
-    while (player == nullptr)
+void Connection::OnReply(Reply& reply)
+{
+    if (reply.event) session->events--;
+    else inFlight--;
+
+    switch (reply.type)
     {
-        Send("Name already taken!\n");
-        name = Read("What is to be your name? ");
+        case Reply::LoggedIn:
+        case Reply::Reconnected:
+        {
+            // Name chosen, so from here on it's only idling that times out
+            loop.GetTimers().Cancel(loginTimer);
+            lastActive = loop.GetTimers().Now();
+            idleTimer = loop.GetTimers().Schedule(GetTimeouts().idle, [this]() { OnIdleTimeout(); });
+
+            Send(reply.type == Reply::Reconnected ? "Welcome back, " : "Greetings, ");
+            Send(reply.text);
+            Send("!\n\n");
+            Send("> ");
+            playerName = std::move(reply.text);
+            state = State::Playing;
+        }
+        break;
 
-        if (!alive) goto terminate;
+        case Reply::NameTaken:
+            Send("Name already taken!\n");
+            Send("What is to be your name? ");
+        break;
 
-        player = Game::Get().AddPlayer(name);
+        case Reply::Resumed:
+        break;
+
+        // Return output, handing over the player's buffer rather than copying it
+        case Reply::Output:
+            Send("\n");
+            Send(std::move(reply.text), reply.splices);
+            Send("> ");
+        break;
+
+        case Reply::Farewell:
+            Send("\n");
+            Send(std::move(reply.text), reply.splices);
+            if (IsReading()) state = State::Closing;
+        break;
     }
 
-    // Name chosen, proceed
-    Send("Greetings, ");
-    Send(name);
-    Send("!\n\n");
+    CheckOutput();
+}
+
+void Connection::Send(std::string_view string)
+{
+    if (compressor) compressor->Compress(string, output);
+    else output.Append(string);
+}
+
+void Connection::Send(std::string&& string)
+{
+    if (compressor) compressor->Compress(string, output);
+    else output.Append(std::move(string));
+}
 
-    while (alive)
+void Connection::Send(const std::shared_ptr<const std::string>& string)
+{
+    if (compressor) compressor->Compress(*string, output);
+    else output.Append(string);
+}
+
+void Connection::Send(std::string&& string, const std::vector<OutputSplice>& splices)
+{
+    if (splices.empty())
     {
-        // Do command
-        const auto command = Read("> ");
-        alive = Game::Get().OnCommand(command, *player);
-        
-        // Return output
-        player->outputBuffer += "\n";
-        Send("\n" + player->outputBuffer);
-        player->outputBuffer = "";
+        Send(std::move(string));
+        return;
     }
 
-terminate:
-    std::cout << "Connection closed at address " << address << std::endl;
-    close(clientFd);
+    // Whatever's shared goes out by reference, between the pieces around it
+    size_t sent = 0;
+    for (const auto& splice : splices)
+    {
+        Send(std::string_view(string).substr(sent, splice.offset - sent));
+        Send(splice.text);
+        sent = splice.offset;
+    }
+
+    Send(std::string_view(string).substr(sent));
+}
+
+int Connection::GatherOutput(iovec* vectors, const int maxVectors, const bool inFlight)
+{
+    // Compressed output only becomes readable for the client once flushed
+    if (compressor) compressor->Flush(output);
+    return output.Gather(vectors, maxVectors, inFlight);
+}
+
+void Connection::CheckOutput()
+{
+    const auto& limits = GetOutputLimits();
+    if (output.Size() >= limits.highWatermark && !paused)
+    {
+        // A client that stops reading altogether would otherwise stay paused forever
+        paused = true;
+        stallTimer = loop.GetTimers().Schedule(GetTimeouts().stall, [this]() { OnStallTimeout(); });
+    }
+
+    if (output.Size() > limits.limit) OnSlowClient();
+}
+
+void Connection::OnSlowClient()
+{
+    // Dropping part of a compressed stream would corrupt the rest, so that's not an option
+    if (GetOutputLimits().disconnect || compressor)
+    {
+        std::cerr << "Disconnecting " << address << " for not keeping up with output" << std::endl;
+        OnHangup();
+        return;
+    }
+
+    // Anything already handed to the kernel has to stay, but the rest can go
+    output.DropUnsent();
+    Send("\n[Some output was dropped as you weren't keeping up]\n");
+    if (state == State::Playing) Send("\n> ");
+}
+
+void Connection::OnSent(const size_t bytes)
+{
+    output.Consume(bytes);
+
+    // Caught up enough to carry on with any commands that were held back
+    if (paused && output.Size() <= GetOutputLimits().lowWatermark)
+    {
+        paused = false;
+        loop.GetTimers().Cancel(stallTimer);
+        ProcessInput();
+    }
+
+    // Any parting words have been sent, so we can finally hang up
+    if (state == State::Closing && !HasOutput())
+        state = State::Closed;
+}
+
+void Connection::OnLoginTimeout()
+{
+    if (state != State::Naming) return;
+
+    Send("\nYou took too long to choose a name; farewell!\n");
+    state = State::Closing;
+    loop.Wake(fd);
+}
+
+void Connection::OnIdleTimeout()
+{
+    if (state != State::Playing) return;
+
+    // Commands only note the time, so check whether any came in since this was scheduled
+    const uint64_t idle = loop.GetTimers().Now() - lastActive;
+    if (idle < GetTimeouts().idle)
+    {
+        idleTimer = loop.GetTimers().Schedule(GetTimeouts().idle - idle, [this]() { OnIdleTimeout(); });
+        return;
+    }
+
+    Send("\nYou have been idle too long; farewell!\n");
+    state = State::Closing;
+    loop.Wake(fd);
 }
 
-Connection::~Connection() {}
+void Connection::OnStallTimeout()
+{
+    if (!paused || IsClosed()) return;
+
+    // Still not caught up, so deal with it as though it had gone over the limit
+    std::cerr << "Client at " << address << " stalled above the high watermark" << std::endl;
+    OnSlowClient();
+
+    // Having had its output dropped, it carries on as soon as it reads again (and
+    // if it never does, the same happens again)
+    if (!IsClosed())
+        stallTimer = loop.GetTimers().Schedule(GetTimeouts().stall, [this]() { OnStallTimeout(); });
+
+    loop.Wake(fd);
+}
+
+Connection::~Connection()
+{
+    // The simulation forgets the session too, though it may reply once or twice more first
+    session->connection = nullptr;
+    Post(Command::Disconnect, {});
+
+    loop.GetTimers().Cancel(loginTimer);
+    loop.GetTimers().Cancel(idleTimer);
+    loop.GetTimers().Cancel(stallTimer);
+
+    std::cout << "Connection closed at address " << address << std::endl;
+    close(fd);
+}
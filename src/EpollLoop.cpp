@@ -0,0 +1,279 @@
+#include "EpollLoop.h"
+
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#define MAX_EVENTS 256
+
+EpollLoop::EpollLoop(int serverFd) : EventLoop(serverFd)
+{
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+    {
+        perror("Unable to create epoll instance");
+        exit(-1);
+    }
+
+    // The listener must never block either, else a client that vanishes between
+    // epoll waking us and us calling accept() would hang every other player
+    fcntl(serverFd, F_SETFL, fcntl(serverFd, F_GETFL, 0) | O_NONBLOCK);
+
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = serverFd;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, serverFd, &event) < 0)
+    {
+        perror("Unable to watch server socket");
+        exit(-1);
+    }
+
+    event.data.fd = GetStopFd();
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, GetStopFd(), &event) < 0)
+    {
+        perror("Unable to watch stop event");
+        exit(-1);
+    }
+
+    event.data.fd = wakeFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) < 0)
+    {
+        perror("Unable to watch wake event");
+        exit(-1);
+    }
+}
+
+void EpollLoop::Run()
+{
+    epoll_event events[MAX_EVENTS];
+    int timeout = RunTimers();
+
+    // Clients (adopted, or left over from an earlier run) may already be waiting,
+    // which being edge-triggered we'd otherwise never hear about
+    OnAccept();
+    DeliverReplies();
+    for (auto& [fd, connection] : connections)
+    {
+        OnReadable(*connection);
+        dirty.emplace_back(fd);
+    }
+
+    Flush();
+
+    while (1)
+    {
+        // Sleep no longer than the next timer allows
+        const int count = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+        if (count < 0)
+        {
+            if (errno == EINTR) continue;
+            perror("Unable to wait for events");
+            return;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            const int fd = events[i].data.fd;
+
+            if (fd == serverFd)
+            {
+                OnAccept();
+                continue;
+            }
+
+            if (fd == wakeFd)
+            {
+                DeliverReplies();
+                continue;
+            }
+
+            // Send what we can before handing over
+            if (fd == GetStopFd())
+            {
+                Flush();
+                return;
+            }
+
+            // May have been closed by an earlier event in this batch
+            const auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            auto& connection = *it->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) connection.OnHangup();
+
+            // Read before honouring a hang-up, as the last command may have come with it
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP)) OnReadable(connection);
+
+            // Hold off sending until the whole batch is handled, so that everything
+            // produced for a connection goes out together in one write
+            if (connection.IsClosed()) CloseConnection(fd);
+            else if (events[i].events & EPOLLOUT || connection.HasOutput()) dirty.emplace_back(fd);
+        }
+
+        // Anything a timer says to a connection goes out with the rest of the batch
+        timeout = RunTimers();
+        Flush();
+    }
+}
+
+void EpollLoop::Flush()
+{
+    for (const int fd : dirty)
+    {
+        const auto it = connections.find(fd);
+        if (it == connections.end()) continue;
+
+        auto& connection = *it->second;
+        bool paused = connection.IsReading() && !connection.WantsInput();
+        OnWritable(connection);
+
+        // Being edge-triggered, we won't be told again about input that arrived
+        // whilst we weren't reading, so catch up with it now (for as long as
+        // sending keeps up with it)
+        while (paused && connection.WantsInput())
+        {
+            OnReadable(connection);
+            paused = connection.IsReading() && !connection.WantsInput();
+            OnWritable(connection);
+        }
+
+        if (connection.IsClosed()) CloseConnection(fd);
+    }
+
+    dirty.clear();
+}
+
+void EpollLoop::OnAccept()
+{
+    // Edge-triggered, so accept everybody who's waiting, not just the first
+    while (1)
+    {
+        int clientFd = accept4(serverFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (clientFd < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+
+            perror("Unable to accept client connection");
+            return;
+        }
+
+        // Watch for both directions at once; being edge-triggered, we're only
+        // told about writability again once a full socket buffer drains
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = clientFd;
+
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, clientFd, &event) < 0)
+        {
+            perror("Unable to watch client socket");
+            close(clientFd);
+            continue;
+        }
+
+        AddConnection(clientFd);
+        dirty.emplace_back(clientFd);
+    }
+}
+
+void EpollLoop::Adopt(const Connection::Snapshot& snapshot)
+{
+    fcntl(snapshot.fd, F_SETFL, fcntl(snapshot.fd, F_GETFL, 0) | O_NONBLOCK);
+
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = snapshot.fd;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, snapshot.fd, &event) < 0)
+    {
+        perror("Unable to watch client socket");
+        close(snapshot.fd);
+        return;
+    }
+
+    // Input another backend had already taken off the socket can't be put back, so
+    // anything a paused connection won't take is lost (though it's seldom much)
+    auto& connection = AddConnection(snapshot);
+    if (connection.OnReceive(snapshot.unread.data(), snapshot.unread.size()) < snapshot.unread.size())
+        std::cerr << "Dropped input carried over for " << snapshot.address << std::endl;
+
+    dirty.emplace_back(snapshot.fd);
+}
+
+void EpollLoop::OnReadable(Connection& connection)
+{
+    // Edge-triggered, so keep reading until the socket runs dry (or until we've
+    // got a backlog, leaving the rest in the kernel to push back on the client)
+    while (connection.WantsInput())
+    {
+        char buffer[BUFFER_SIZE];
+        ssize_t bytes = read(connection.fd, buffer, std::min(sizeof(buffer), connection.InputSpace()));
+
+        if (bytes < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+
+            perror("Unable to read client socket");
+            connection.OnHangup();
+            return;
+        }
+
+        else if (bytes == 0)
+        {
+            // Connection closed
+            connection.OnHangup();
+            return;
+        }
+
+        connection.OnReceive(buffer, bytes);
+    }
+}
+
+void EpollLoop::OnUnblocked(Connection& connection)
+{
+    // Being edge-triggered, we won't be told again about input that's already waiting
+    OnReadable(connection);
+}
+
+void EpollLoop::OnWritable(Connection& connection)
+{
+    iovec vectors[MAX_OUTPUT_VECTORS];
+
+    while (connection.HasOutput() && !connection.IsClosed())
+    {
+        msghdr message = {};
+        message.msg_iov = vectors;
+        message.msg_iovlen = connection.GatherOutput(vectors, MAX_OUTPUT_VECTORS, false);
+
+        ssize_t bytes = sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+
+        if (bytes < 0)
+        {
+            // Kernel buffer is full; we'll be told when it empties
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+
+            connection.OnHangup();
+            return;
+        }
+
+        connection.OnSent(bytes);
+    }
+}
+
+void EpollLoop::CloseConnection(const int fd)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    connections.erase(fd);
+}
+
+EpollLoop::~EpollLoop()
+{
+    connections.clear();
+    close(epollFd);
+}
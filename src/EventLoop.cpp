@@ -0,0 +1,235 @@
+#include "EventLoop.h"
+#include "EpollLoop.h"
+#include "UringLoop.h"
+#include "Config.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define BACKLOG 128
+#define TIMER_TICK_MS 50
+
+EventLoop::EventLoop(int serverFd) :
+    serverFd(serverFd), timers(Config::Get().GetInt("timer_tick_ms", TIMER_TICK_MS)), signalled(false)
+{
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0)
+    {
+        perror("Unable to create wake event");
+        exit(-1);
+    }
+}
+
+std::unique_ptr<EventLoop> EventLoop::Create(int serverFd, const Backend backend)
+{
+    if (backend == Backend::Uring)
+    {
+#ifdef SLUDGE_IO_URING
+        auto loop = std::make_unique<UringLoop>(serverFd);
+        if (loop->Initialise())
+        {
+            std::cout << "Using io_uring backend" << std::endl;
+            return loop;
+        }
+
+        std::cerr << "io_uring unavailable, falling back to epoll" << std::endl;
+#else
+        std::cerr << "Built without io_uring support, falling back to epoll" << std::endl;
+#endif
+    }
+
+    std::cout << "Using epoll backend" << std::endl;
+    return std::make_unique<EpollLoop>(serverFd);
+}
+
+EventLoop::Backend EventLoop::ParseBackend(const std::string& name)
+{
+    if (name == "io_uring" || name == "uring") return Backend::Uring;
+    if (name != "epoll") std::cerr << "Unknown backend " << name << ", using epoll" << std::endl;
+    return Backend::Epoll;
+}
+
+int EventLoop::Listen(const int port)
+{
+    // Create socket
+    int serverFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (serverFd < 0)
+    {
+        perror("Unable to create socket");
+        exit(-1);
+    }
+
+    // Tell the kernel that, in cases where the socket has been recently used 
+    // (i.e. we just crashed and restarted), we don't care for waiting the 30
+    // or so seconds to make a new one, we're happy to just ditch the old and start afresh.
+    int opt = 1;
+    if (setsockopt(serverFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    {
+        perror("Unable to reuse sockets");
+        exit(-1);
+    }
+
+#ifdef __APPLE__
+    // Tell the kernel too that any CTRL-C's sent over ought not to disconnect or
+    // close the socket, but rather just raise an error whenever we use it. (In other
+    // words, don't crash the server thread when a user exits).
+    if (setsockopt(serverFd, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt)) < 0)
+    {
+        perror("Unable to use SE_NOSIGPIPE");
+        exit(-1);
+    }
+#endif
+
+    // Bind to port
+    struct sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+
+    if (bind(serverFd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("Unable to bind to port");
+        exit(-1);
+    }
+
+    // Mark the socket as a "passive socket"; i.e we want to listen
+    if (listen(serverFd, BACKLOG) < 0)
+    {
+        perror("Unable to listen with socket");
+        exit(-1);
+    }
+
+    return serverFd;
+}
+
+Connection& EventLoop::AddConnection(int clientFd)
+{
+    // Get IP (internally stored per-thread, so copy)
+    sockaddr_in clientAddress = {};
+    socklen_t clientAddressSize = sizeof(clientAddress);
+    getpeername(clientFd, (struct sockaddr*)&clientAddress, &clientAddressSize);
+
+    std::string address = inet_ntoa(clientAddress.sin_addr);
+    std::cout << "New connection received from " << address << std::endl;
+
+    // Output is already corked by the loops, which only ever flush once everything
+    // from an iteration has been queued, so Nagle's algorithm would only add delay
+    int opt = 1;
+    setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    auto& connection = connections[clientFd];
+    connection = std::make_unique<Connection>(clientFd, address, *this);
+    return *connection;
+}
+
+Connection& EventLoop::AddConnection(const Connection::Snapshot& snapshot)
+{
+    std::cout << "Connection resumed from " << snapshot.address << std::endl;
+
+    auto& connection = connections[snapshot.fd];
+    connection = std::make_unique<Connection>(snapshot, *this);
+    return *connection;
+}
+
+std::vector<Connection::Snapshot> EventLoop::Save()
+{
+    std::vector<Connection::Snapshot> snapshots;
+    for (auto& [fd, connection] : connections)
+    {
+        if (!connection->IsClosed())
+            snapshots.emplace_back(connection->Save());
+    }
+
+    return snapshots;
+}
+
+void EventLoop::Resume(const std::vector<Connection::Snapshot>& snapshots)
+{
+    // Saving ended any compression, so offer it again
+    for (const auto& snapshot : snapshots)
+    {
+        const auto it = connections.find(snapshot.fd);
+        if (it != connections.end() && snapshot.compressed) it->second->OfferCompression();
+    }
+}
+
+int EventLoop::GetStopFd()
+{
+    // Shared by every loop; never read whilst stopping, so it wakes them all
+    static const int stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return stopFd;
+}
+
+void EventLoop::Stop()
+{
+    const uint64_t value = 1;
+    if (write(GetStopFd(), &value, sizeof(value)) < 0)
+        perror("Unable to stop event loops");
+}
+
+void EventLoop::Continue()
+{
+    uint64_t value;
+    while (read(GetStopFd(), &value, sizeof(value)) > 0);
+}
+
+int EventLoop::RunTimers()
+{
+    timers.Advance();
+    return timers.GetTimeout();
+}
+
+void EventLoop::Notify(const std::shared_ptr<Session>& session)
+{
+    ready.Push(session);
+
+    // Only the first notification since the loop last looked needs to wake it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!signalled.exchange(true))
+    {
+        const uint64_t value = 1;
+        if (write(wakeFd, &value, sizeof(value)) < 0)
+            perror("Unable to wake event loop");
+    }
+}
+
+void EventLoop::DeliverReplies()
+{
+    uint64_t value;
+    while (read(wakeFd, &value, sizeof(value)) > 0);
+
+    // Anything notified from here on wakes us again
+    signalled = false;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::shared_ptr<Session> session;
+    while (ready.Pop(session))
+    {
+        session->queued = false;
+
+        // Replies for connections that have since gone are simply thrown away
+        Connection* connection = session->connection;
+        if (connection == nullptr)
+        {
+            Reply reply;
+            while (session->replies.Pop(reply));
+            continue;
+        }
+
+        const bool blocked = connection->IsReading() && !connection->WantsInput();
+        connection->OnReplies();
+
+        if (blocked && connection->WantsInput()) OnUnblocked(*connection);
+        dirty.emplace_back(connection->fd);
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    connections.clear();
+    close(wakeFd);
+}
@@ -1,24 +1,24 @@
 #include "Game.h"
+#include "Combat.h"
 #include "World.h"
 #include "Cave.h"
+#include "Config.h"
+#include "Simulation.h"
+
+#include <charconv>
+
+#define ENEMY_RESPAWN_DELAY 300
+#define MAX_BATCH_COMMANDS 16
+#define MAX_ALIASES 32
+#define MAX_ALIAS_LENGTH 256
 
 Game::Game()
 {
     // Load variables
-    motd = ReadFile("motd.txt");
+    motd = std::make_shared<const std::string>(ReadFile("motd.txt"));
     seed = std::stoi(ReadFile("seed.txt"));
-
-    attackVerbs = ReadLines("combat/attack/verbs.txt");
-    attackMinimalDamageDescriptions = ReadLines("combat/attack/minimal_damages.txt");
-    attackModerateDamageDescriptons = ReadLines("combat/attack/moderate_damages.txt");
-    attackMajorDamageDescriptions = ReadLines("combat/attack/major_damages.txt");
-
-    combatPrefixes = ReadLines("combat/prefixes.txt");
-    combatObjects = ReadLines("combat/objects.txt");
-
-    defenceMinimalDamageDescriptions = ReadLines("combat/defence/minimal_damages.txt");
-    defenceModerateDamageDescriptons = ReadLines("combat/defence/moderate_damages.txt");
-    defenceMajorDamageDescriptions = ReadLines("combat/defence/major_damages.txt");
+    salt = ((uint64_t) std::random_device()() << 32) | std::random_device()();
+    incarnations = 0;
 
     // Create items
     items.emplace_back(Item("Cave Mushroom", "a 5 HP mushroom found amongst shadows and stone", 5, 0, 0, 5));
@@ -199,20 +199,26 @@ Game::Game()
         }, 
         "Gremlin", 30, 80
     );
+
+    // Along with their own words, compile everything fights are told with
+    narration.Load(enemies);
 }
 
 Player* Game::AddPlayer(const std::string& name)
 {
-    if (players.count(name)) return nullptr;
-    players.emplace(name, Player(name, 0, areas[0]->GetStartingCell()));
-
-    return &players.at(name);
+    Player player(name, 0, areas[0]->GetStartingCell());
+    player.random = MakeRandom(name);
+    return players.Reserve(std::move(player));
 }
 
 Player* Game::GetPlayer(const std::string& name)
 {
-    if (!players.count(name)) return nullptr;
-    return &players.at(name);
+    return players.Find(name);
+}
+
+Random Game::MakeRandom(const std::string& name)
+{
+    return Random(Random::Hash(std::hash<std::string>()(name), seed, salt, incarnations++));
 }
 
 AreaID Game::AddArea(Area* area)
@@ -239,298 +245,579 @@ void Game::LoadAreas()
     std::cout << "Game loaded" << std::endl;
 }
 
-bool Game::OnCommand(const std::string& string, Player& player)
+const auto& Game::GetVerbs()
 {
-    // Check for non-empty message
-    if (string.size() == 0)
+    // New verbs need only be added here, in the order help lists them
+    static constexpr GameVerb verbs[] =
     {
-        player << "Unknown or invalid command\n";
-        return true;
-    }
+        { "wield",   GameVerb::Required, &Game::OnWield,   "[item]", "equip item for combat" },
+        { "wear",    GameVerb::Required, &Game::OnWear,    "[item]", "wear item for defence" },
+        { "consume", GameVerb::Required, &Game::OnConsume, "[item]", "eat or drink item for health" },
+        { "unwield", GameVerb::None,     &Game::OnUnwield, "",       "unequip currently wielded item" },
+        { "unwear",  GameVerb::None,     &Game::OnUnwear,  "",       "unequip currently worn item" },
+        { "look",    GameVerb::None,     &Game::OnLook,    "",       "see surrounding area" },
+        { "items",   GameVerb::None,     &Game::OnItems,   "",       "view nearby items" },
+        { "get",     GameVerb::Required, &Game::OnGet,     "[item]", "pickup item" },
+        { "browse",  GameVerb::None,     &Game::OnBrowse,  "",       "browse vendor's items" },
+        { "buy",     GameVerb::Required, &Game::OnBuy,     "[item]", "buy vendor's item" },
+        { "sell",    GameVerb::None,     &Game::OnSell,    "[item]", "sell vendor's item (or all [name] to sell every item with that in its name)" },
+        { "info",    GameVerb::None,     &Game::OnInfo,    "",       "view player stats" },
+        { "move",    GameVerb::None,     &Game::OnMove,    "",       "move to new area" },
+        { "map",     GameVerb::None,     &Game::OnMap,     "[pinned/inline]", "keep the world map at the top of the screen, or in with everything else" },
+        { "alias",   GameVerb::None,     &Game::OnAlias,   "[name] \"[commands]\"", "name commands (separated by ;) to run together, or list names" },
+        { "unalias", GameVerb::None,     &Game::OnUnalias, "[name]", "forget a name given to commands" },
+        { "quit",    GameVerb::None,     &Game::OnQuit,    "",       "disconnect" },
+        { "help",    GameVerb::None,     &Game::OnHelp,    "",       "list commands" },
+        { "w",       GameVerb::Optional, &Game::OnUp,      "",       "move up" },
+        { "s",       GameVerb::Optional, &Game::OnDown,    "",       "move down" },
+        { "a",       GameVerb::Optional, &Game::OnLeft,    "",       "move left" },
+        { "d",       GameVerb::Optional, &Game::OnRight,   "",       "move right" },
+    };
 
-    // Parse command
-    const char* data = string.data();
-    std::string command;
-    unsigned int i = 0;
-    while (data[i] != '\0' && data[i] != ' ')
-    {
-        command += data[i];
-        i++;
-    }
+    static constexpr VerbTable table(verbs);
+    return table;
+}
 
-    // Space remains for arguments; treat as int
-    std::optional<int> arg;
-    if (i+1 < string.size())
+// Where the first command on the line ends, ignoring any ; in quotes
+static size_t FindSeparator(const std::string_view commands)
+{
+    bool quoted = false;
+    for (size_t i = 0; i < commands.size(); ++i)
     {
-        if (std::all_of(string.begin()+i+1, string.end(), ::isdigit))
-            arg = std::stoi(data+i+1);
+        if (commands[i] == '"') quoted = !quoted;
+        else if (commands[i] == ';' && !quoted) return i;
     }
 
-    /*
-        Findings nth item where N starts from *1*!
-    */
-    const auto GetNthItem = [&](const size_t n, const std::function<void(ItemID)> f)
+    return std::string_view::npos;
+}
+
+bool Game::OnCommand(const std::string& string, Player& player)
+{
+    static const unsigned int maxBatch = Config::Get().GetInt("max_batch_commands", MAX_BATCH_COMMANDS);
+    unsigned int budget = maxBatch;
+    const bool alive = OnCommands(string, player, budget);
+
+    // Empty pieces between separators are skipped, but a line that's nothing but
+    // those (or nothing at all) had no command in it
+    if (budget == maxBatch && maxBatch > 0) player << "Unknown or invalid command\n";
+    return alive;
+}
+
+bool Game::OnCommands(std::string_view commands, Player& player, unsigned int& budget)
+{
+    while (!commands.empty())
     {
-        if (n > player.items.size() || n == 0)
+        const size_t separator = FindSeparator(commands);
+        const std::string_view command = commands.substr(0, separator);
+        commands = separator == std::string_view::npos ? std::string_view() : commands.substr(separator + 1);
+
+        // Parse command, into views of the line rather than copies of it
+        const Tokenizer arguments(command);
+        if (arguments.IsValid() && arguments.GetVerb().empty()) continue;
+
+        // Every command and alias counts, so aliases naming themselves soon stop
+        if (budget == 0)
         {
-            player << "You have no such item\n";
-            return;
+            player << "Too many commands at once; the rest were skipped\n";
+            return true;
         }
- 
-        size_t i = 1;
-        for (const auto& [key, value] : player.items)
+
+        budget--;
+
+        const AreaID area = player.area;
+        const auto alias = player.aliases.empty() ? player.aliases.end() : player.aliases.find(arguments.GetVerb());
+        if (alias != player.aliases.end())
         {
-            if (i++ == n)
-            {
-                f(key);
-            }
+            // Copied, as the alias may be changed by its own commands
+            const std::string expansion = alias->second;
+            if (!OnCommands(expansion, player, budget)) return false;
         }
-    };
 
-    if (command == "help")
-    {
-        player << "- wield [item] - equip item for combat\n";
-        player << "- wear [item] - wear item for defence\n";
-        player << "- consume [item] - eat or drink item for health\n";
-        player << "- unwield - unequip currently wielded item\n";
-        player << "- unwear - unequip currently worn item\n";
-        player << "- look - see surrounding area\n";
-        player << "- items - view nearby items\n";
-        player << "- get [item] - pickup item\n";
-        player << "- browse - browse vendor's items\n";
-        player << "- buy [item] - buy vendor's item\n";
-        player << "- sell [item] - sell vendor's item\n";
-        player << "- info - view player stats\n";
-        player << "- move - move to new area\n";
-        player << "- quit - disconnect\n";
-        player << "- help - list commands\n";
-        player << "- w - move up\n";
-        player << "- s - move down\n";
-        player << "- a - move left\n";
-        player << "- d - move right\n";
-    }
-
-    else if (command == "wield" && arg.has_value())
-    {
-        GetNthItem(arg.value(), [&](ItemID id)
+        else
         {
-            player.weapon = id;
-            player << "You now wield a " << items[id].name << "\n";
-        });
-    }
+            // Each command's output is set apart from the last's
+            if (!player.output.Empty()) player << "\n";
+            if (!OnCommand(arguments, player)) return false;
+        }
 
-    else if (command == "wear" && arg.has_value())
-    {
-        GetNthItem(arg.value(), [&](ItemID id)
+        // Through a portal, the other side belongs to another strand, so the rest
+        // waits for OnArrival()
+        if (player.area != area)
         {
-            player.armour = id;
-            player << "You now wear a " << items[id].name << "\n";
-        });
+            if (!commands.empty())
+            {
+                if (!player.pendingCommands.empty()) player.pendingCommands += ";";
+                player.pendingCommands += commands;
+            }
+
+            player.pendingBudget = budget;
+            return true;
+        }
     }
 
-    else if (command == "consume" && arg.has_value())
+    return true;
+}
+
+bool Game::OnCommand(const Tokenizer& arguments, Player& player)
+{
+    const GameVerb* verb = arguments.IsValid() ? GetVerbs().Find(arguments.GetVerb()) : nullptr;
+    if (verb == nullptr || (verb->argument == GameVerb::Required && !arguments.GetNumber(0).has_value()))
+        player << "Unknown or invalid command\n";
+
+    else
     {
-        GetNthItem(arg.value(), [&](ItemID id)
+        const AreaID area = player.area;
+        const Cell cell = player.cell;
+        if (!(this->*verb->handler)(player, arguments)) return false;
+
+        // Getting away is all it takes to flee a fight
+        if (player.foe.has_value() && (player.area != area || player.cell != cell))
         {
-            if (items[id].health == 0)
-            {
-                player << "Such a thing cannot be consumed!\n";
-                return;
-            }
-            
-            player.health = std::min(player.health + items[id].health, MAX_PLAYER_HEALTH);
-            player << "You consume a " << items[id].name << " for " << items[id].health << " health\n";
-            player.RemoveItem(id);
-        });
+            player << "You flee from the " << enemies[*player.foe].name << "!\n";
+            player.foe.reset();
+        }
+
+        if (player.area != area) return true;
     }
 
-    else if (command == "unwield")
+    OnEncounter(player);
+    return true;
+}
+
+/*
+    Findings nth item where N starts from *1*!
+*/
+std::optional<ItemID> Game::GetNthItem(Player& player, const size_t n)
+{
+    const ItemStack* stack = player.items.GetNth(n);
+    if (stack == nullptr)
     {
-        player.weapon.reset();
-        player << "You now wield no weapon\n";
+        player << "You have no such item\n";
+        return {};
     }
 
-    else if (command == "unwear")
+    return stack->item;
+}
+
+bool Game::OnHelp(Player& player, const Tokenizer&)
+{
+    for (const GameVerb& verb : GetVerbs())
     {
-        player.armour.reset();
-        player << "You take off anything previously worn\n";
+        player << "- " << verb.name;
+        if (!verb.usage.empty()) player << " " << verb.usage;
+        player << " - " << verb.description << "\n";
     }
 
-    else if (command == "look")
+    player << "\nSeparate commands with ; to run several at once\n";
+    return true;
+}
+
+bool Game::OnWield(Player& player, const Tokenizer& arguments)
+{
+    if (const auto id = GetNthItem(player, *arguments.GetNumber(0)))
     {
-        areas[player.area]->Look(player);
-        PrintItems(player, false);
+        player.weapon = *id;
+        player << "You now wield a " << items[*id].name << "\n";
     }
 
-    else if (command == "items")
+    return true;
+}
+
+bool Game::OnWear(Player& player, const Tokenizer& arguments)
+{
+    if (const auto id = GetNthItem(player, *arguments.GetNumber(0)))
     {
-        PrintItems(player, true);
+        player.armour = *id;
+        player << "You now wear a " << items[*id].name << "\n";
     }
 
-    else if (command == "get" && arg.has_value())
+    return true;
+}
+
+bool Game::OnConsume(Player& player, const Tokenizer& arguments)
+{
+    const auto id = GetNthItem(player, *arguments.GetNumber(0));
+    if (!id.has_value()) return true;
+
+    if (items[*id].health == 0)
     {
-        auto& itemStacks = areas[player.area]->GetItems(player.cell);
+        player << "Such a thing cannot be consumed!\n";
+        return true;
+    }
 
-        // Check item ID and args exists
-        if ((unsigned int)arg.value() <= itemStacks.size() && arg.value() != 0)
-        {
-            // Give item to player
-            const auto itemID = itemStacks[arg.value()-1].item;
-            player.items[itemID]++;
-            player << "You pick up a " << items[itemID].name << "\n";
-
-            // Remove item from area
-            if (itemStacks[arg.value()-1].number > 1)
-                itemStacks[arg.value()-1].number--;
-            else
-                itemStacks.erase(itemStacks.begin() + arg.value()-1);
-        }
+    player.health = std::min(player.health + items[*id].health, MAX_PLAYER_HEALTH);
+    player << "You consume a " << items[*id].name << " for " << items[*id].health << " health\n";
+    player.RemoveItem(*id);
+
+    return true;
+}
+
+bool Game::OnUnwield(Player& player, const Tokenizer&)
+{
+    player.weapon.reset();
+    player << "You now wield no weapon\n";
+    return true;
+}
+
+bool Game::OnUnwear(Player& player, const Tokenizer&)
+{
+    player.armour.reset();
+    player << "You take off anything previously worn\n";
+    return true;
+}
+
+bool Game::OnLook(Player& player, const Tokenizer&)
+{
+    areas[player.area]->Look(player);
+    PrintItems(player, false);
+    return true;
+}
+
+bool Game::OnItems(Player& player, const Tokenizer&)
+{
+    PrintItems(player, true);
+    return true;
+}
+
+bool Game::OnGet(Player& player, const Tokenizer& arguments)
+{
+    auto& itemStacks = areas[player.area]->GetItems(player.cell);
+    const int arg = *arguments.GetNumber(0);
+
+    // Check item ID and args exists
+    if ((unsigned int)arg <= itemStacks.size() && arg != 0)
+    {
+        // Give item to player
+        const auto itemID = itemStacks[arg-1].item;
+        player.items.Add(itemID);
+        player << "You pick up a " << items[itemID].name << "\n";
+
+        // Remove item from area
+        if (itemStacks[arg-1].number > 1)
+            itemStacks[arg-1].number--;
         else
-            player << "That item does not exist here\n";
+            itemStacks.erase(itemStacks.begin() + arg-1);
+
+        areas[player.area]->GetItemTable(player.cell).Invalidate();
     }
+    else
+        player << "That item does not exist here\n";
 
-    else if (command == "browse")
+    return true;
+}
+
+bool Game::OnBrowse(Player& player, const Tokenizer&)
+{
+    const auto& vendor = areas[player.area]->GetVendor(player.cell);
+    if (vendor == nullptr) player << "No vendor will serve you here\n";
+    else
     {
-        const auto& vendor = areas[player.area]->GetVendor(player.cell);
-        if (vendor == nullptr) player << "No vendor will serve you here\n";
-        else
-        {
-            PrintItems(player, vendor->items);
-        }
+        PrintItems(player, vendor->items, vendor->table);
     }
 
-    else if (command == "buy" && arg.has_value())
+    return true;
+}
+
+bool Game::OnBuy(Player& player, const Tokenizer& arguments)
+{
+    const int arg = *arguments.GetNumber(0);
+
+    // Check for vendor
+    Vendor* vendor = areas[player.area]->GetVendor(player.cell);
+    if (vendor == nullptr) player << "No vendor will serve you here\n";
+
+    else
     {
-        // Check for vendor
-        Vendor* vendor = areas[player.area]->GetVendor(player.cell);
-        if (vendor == nullptr) player << "No vendor will serve you here\n";
+        // Check for valid item
+        if ((unsigned int)arg > vendor->items.size() || arg == 0) player << "There is no such item for sale\n";
 
         else
         {
-            // Check for valid item
-            if ((unsigned int)arg.value() > vendor->items.size() || arg.value() == 0) player << "There is no such item for sale\n";
+            // Check for enough money
+            auto& itemStack = vendor->items[arg - 1];
+            const auto& item = items[itemStack.item];
 
+            if (item.price > player.money) player << "You haven't the money\n";
             else
             {
-                // Check for enough money
-                auto& itemStack = vendor->items[arg.value() - 1];
-                const auto& item = items[itemStack.item];
-
-                if (item.price > player.money) player << "You haven't the money\n";
-                else
-                {
-                    // Give to player...
-                    player.items[itemStack.item]++;
-                    player.money -= item.price;
-                    player << "You buy the " << item.name << " for " << item.price << " gold\n";
-
-                    // ...and take from vendor
-                    vendor->RemoveItem(arg.value() - 1);
-                }
+                // Give to player...
+                player.items.Add(itemStack.item);
+                player.money -= item.price;
+                player << "You buy the " << item.name << " for " << item.price << " gold\n";
+
+                // ...and take from vendor
+                vendor->RemoveItem(arg - 1);
             }
         }
     }
 
-    else if (command == "sell" && arg.has_value())
+    return true;
+}
+
+bool Game::OnSell(Player& player, const Tokenizer& arguments)
+{
+    const auto arg = arguments.GetNumber(0);
+    const bool all = arguments.GetArgumentCount() > 0 && arguments.GetArgument(0).text == "all";
+    if (!arg.has_value() && !all)
+    {
+        player << "Unknown or invalid command\n";
+        return true;
+    }
+
+    // Check for vendor
+    Vendor* vendor = areas[player.area]->GetVendor(player.cell);
+    if (vendor == nullptr) player << "No vendor will serve you here\n";
+
+    else if (all) SellAll(player, *vendor, arguments.GetText(1).value_or(""));
+
+    else
     {
-        // Check for vendor
-        Vendor* vendor = areas[player.area]->GetVendor(player.cell);
-        if (vendor == nullptr) player << "No vendor will serve you here\n";
+        // Check for valid item
+        const ItemStack* stack = player.items.GetNth(*arg);
+        if (stack == nullptr) player << "You have no such item to sell\n";
 
         else
         {
-            // Check for valid item
-            if ((unsigned int)arg.value() > player.items.size() || arg.value() == 0) player << "You have no such item to sell\n";
+            // Give to vendor and take from player
+            const ItemID itemID = stack->item;
+            vendor->AddItem(itemID);
+            player.money += items[itemID].price;
+            player.RemoveItem(itemID);
 
-            else
-            {
-                // Find item
-                ItemID itemID = 99999999;
-                int i = 1;
-
-                for (const auto& [key, value] : player.items)
-                {
-                    if (i++ == arg.value())
-                        itemID = key;
-                }
-
-                // Give to vendor and take from player
-                vendor->AddItem(itemID);
-                player.money += items[itemID].price;
-                player.RemoveItem(itemID);
-
-                player << "You sell the " << items[itemID].name << " for " << items[itemID].price << " gold\n";
-            }
+            player << "You sell the " << items[itemID].name << " for " << items[itemID].price << " gold\n";
         }
     }
 
-    else if (command == "info")
+    return true;
+}
+
+void Game::SellAll(Player& player, Vendor& vendor, const std::string_view match)
+{
+    const auto Matches = [&](const std::string& name)
     {
-        player << "Name: " << player.name << "\n";
-        player << "Health: " << player.health << "\n";
-        player << "Level: " << player.level << "\n";
-        player << "Gold: " << player.money << "\n\n";
+        return std::search(name.begin(), name.end(), match.begin(), match.end(),
+            [](const char a, const char b) { return tolower((unsigned char) a) == tolower((unsigned char) b); }) != name.end();
+    };
 
-        if (player.items.size() == 0) player << "You have no items\n";
-        else PrintItems(player, player.GetItemsAsList());
+    unsigned int sold = 0;
+    int gold = 0;
+    bool kept = false;
 
-        player << "\n";
+    // From the back, so selling a stack doesn't move those still to come
+    for (size_t n = player.items.Size(); n > 0; --n)
+    {
+        const ItemStack stack = *player.items.GetNth(n);
+        const Item& item = items[stack.item];
+        if (!Matches(item.name)) continue;
 
-        if (player.weapon.has_value())
-            player << "- You weild your " << items[player.weapon.value()].name << "\n";
-        else
-            player << "- You wield no weaopn\n";
-        
-        if (player.armour.has_value())
-            player << "- You wear your " << items[player.armour.value()].name << "\n";
-        else
-            player << "- You wear no armour\n";
+        // Whatever's in use is kept back
+        if (player.weapon == stack.item || player.armour == stack.item)
+        {
+            kept = true;
+            continue;
+        }
+
+        vendor.AddItem(stack.item, stack.number);
+        player.money += item.price * stack.number;
+        player.RemoveItem(stack.item, stack.number);
+
+        sold += stack.number;
+        gold += item.price * stack.number;
     }
 
-    else if (command == "move")
+    if (sold == 0) player << "You have nothing like that to sell\n";
+    else player << "You sell " << sold << " item" << (sold == 1 ? "" : "s") << " for " << gold << " gold\n";
+
+    if (kept) player << "You keep hold of what you wield and wear\n";
+}
+
+bool Game::OnInfo(Player& player, const Tokenizer&)
+{
+    player << "Name: " << player.name << "\n";
+    player << "Health: " << player.health << "\n";
+    player << "Level: " << player.level << "\n";
+    player << "Gold: " << player.money << "\n\n";
+
+    if (player.items.Empty()) player << "You have no items\n";
+    else PrintItems(player, player.items.GetStacks());
+
+    player << "\n";
+
+    if (player.weapon.has_value())
+        player << "- You weild your " << items[player.weapon.value()].name << "\n";
+    else
+        player << "- You wield no weaopn\n";
+    
+    if (player.armour.has_value())
+        player << "- You wear your " << items[player.armour.value()].name << "\n";
+    else
+        player << "- You wear no armour\n";
+
+    return true;
+}
+
+bool Game::OnMove(Player& player, const Tokenizer&)
+{
+    const auto portal = areas[player.area]->GetPortal(player.cell);
+    if (portal.has_value())
     {
-        const auto portal = areas[player.area]->GetPortal(player.cell);
-        if (portal.has_value())
-        {
-            const auto area = portal->area;
-            player.area = area;
-            player.cell = portal->cell.value_or(areas[area]->GetStartingCell());
+        const auto area = portal->area;
+        player.area = area;
+        player.cell = portal->cell.value_or(areas[area]->GetStartingCell());
+    }
+
+    else
+        player << "You'll find no enterance or exit here!\n";
+
+    return true;
+}
+
+bool Game::OnAlias(Player& player, const Tokenizer& arguments)
+{
+    if (arguments.GetArgumentCount() == 0)
+    {
+        if (player.aliases.empty()) player << "You have named no commands\n";
+        for (const auto& [name, commands] : player.aliases)
+            player << "- " << name << " - " << commands << "\n";
+
+        return true;
+    }
+
+    const Token& name = arguments.GetArgument(0);
+    if (name.type == Token::Text || name.text.find(';') != std::string_view::npos || GetVerbs().Find(name.text) != nullptr)
+    {
+        player << "That name cannot be given to commands\n";
+        return true;
+    }
 
-            areas[player.area]->Look(player);
-            PrintItems(player, false);
+    // Unquoted, the commands run to the end of the line (or the first ;)
+    const size_t count = arguments.GetArgumentCount();
+    std::string_view commands;
+    if (count == 2) commands = arguments.GetArgument(1).text;
+    else if (count > 2)
+    {
+        const std::string_view first = arguments.GetArgument(1).text;
+        const std::string_view last = arguments.GetArgument(count - 1).text;
+        commands = std::string_view(first.data(), last.data() + last.size() - first.data());
+    }
+
+    if (commands.empty())
+    {
+        const auto alias = player.aliases.find(name.text);
+        if (alias == player.aliases.end()) player << "No commands go by that name\n";
+        else player << "- " << alias->first << " - " << alias->second << "\n";
+        return true;
+    }
+
+    if (commands.size() > MAX_ALIAS_LENGTH)
+    {
+        player << "Those commands are too long to name\n";
+        return true;
+    }
+
+    auto alias = player.aliases.find(name.text);
+    if (alias == player.aliases.end())
+    {
+        if (player.aliases.size() >= MAX_ALIASES)
+        {
+            player << "You have named too many commands already\n";
+            return true;
         }
 
-        else
-            player << "You'll find no enterance or exit here!\n";
+        alias = player.aliases.emplace(name.text, std::string()).first;
     }
 
-    else if (command == "quit")
+    alias->second = commands;
+    player << "\"" << alias->first << "\" now runs: " << alias->second << "\n";
+    return true;
+}
+
+bool Game::OnUnalias(Player& player, const Tokenizer& arguments)
+{
+    const auto text = arguments.GetText(0);
+    const auto alias = text.has_value() ? player.aliases.find(*text) : player.aliases.end();
+    if (alias == player.aliases.end())
+        player << "No commands go by that name\n";
+    else
     {
-        player << "Farewell!\n";
-        return false;
+        player.aliases.erase(alias);
+        player << "Forgotten\n";
     }
 
-    else if (command == "w") { areas[player.area]->Move(player, Area::Direction::Up,    arg.value_or(1)); PrintItems(player, false); }
-    else if (command == "s") { areas[player.area]->Move(player, Area::Direction::Down,  arg.value_or(1)); PrintItems(player, false); }
-    else if (command == "a") { areas[player.area]->Move(player, Area::Direction::Left,  arg.value_or(1)); PrintItems(player, false); }
-    else if (command == "d") { areas[player.area]->Move(player, Area::Direction::Right, arg.value_or(1)); PrintItems(player, false); }
+    return true;
+}
 
-    else player << "Unknown or invalid command\n";
+bool Game::OnMap(Player& player, const Tokenizer& arguments)
+{
+    const auto mode = arguments.GetText(0);
+    if (mode == "pinned")
+    {
+        player.pinnedMap = true;
+        player.shownMap.clear();
+        player << "Your map of the world will stay at the top of your screen\n";
+    }
 
-    // Player may have moved, or an enemy may have spawned, who cares?
-    // Either way, check if player shares a cell with one
-    EnemyInstance* enemy = areas[player.area]->GetEnemy(player.cell);
-    if (enemy != nullptr)
+    else if (mode == "inline")
     {
-        player << "\n";
-        bool playerDied = OnCombat(player, *enemy);
-        if (!playerDied) areas[player.area]->DestroyEnemy(player.cell);
-        else return false; 
+        // Let the whole screen scroll again, and start it afresh
+        if (player.pinnedMap && !player.shownMap.empty()) player << "\x1b[r\x1b[2J\x1b[999;1H";
+
+        player.pinnedMap = false;
+        player.shownMap.clear();
+        player << "Your map of the world will appear along with everything else\n";
     }
 
+    else player << "Your map is " << (player.pinnedMap ? "pinned" : "inline") << "; map pinned or map inline to change it\n";
+
     return true;
 }
 
+bool Game::OnQuit(Player& player, const Tokenizer&)
+{
+    player << "Farewell!\n";
+    return false;
+}
+
+bool Game::OnUp(Player& player, const Tokenizer& arguments)    { areas[player.area]->Move(player, Area::Direction::Up,    arguments.GetNumber(0).value_or(1)); PrintItems(player, false); return true; }
+bool Game::OnDown(Player& player, const Tokenizer& arguments)  { areas[player.area]->Move(player, Area::Direction::Down,  arguments.GetNumber(0).value_or(1)); PrintItems(player, false); return true; }
+bool Game::OnLeft(Player& player, const Tokenizer& arguments)  { areas[player.area]->Move(player, Area::Direction::Left,  arguments.GetNumber(0).value_or(1)); PrintItems(player, false); return true; }
+bool Game::OnRight(Player& player, const Tokenizer& arguments) { areas[player.area]->Move(player, Area::Direction::Right, arguments.GetNumber(0).value_or(1)); PrintItems(player, false); return true; }
+
+bool Game::OnArrival(Player& player)
+{
+    areas[player.area]->Look(player);
+    PrintItems(player, false);
+
+    OnEncounter(player);
+
+    // Carry on with whatever's left of the batch that brought them here
+    if (player.pendingCommands.empty()) return true;
+
+    const std::string commands = std::move(player.pendingCommands);
+    player.pendingCommands.clear();
+    unsigned int budget = player.pendingBudget;
+    return OnCommands(commands, player, budget);
+}
+
+void Game::OnEncounter(Player& player)
+{
+    // Player may have moved, or an enemy may have spawned, who cares?
+    // Either way, check if player shares a cell with one
+    if (player.foe.has_value()) return;
+    EnemyInstance* enemy = areas[player.area]->GetEnemy(player.cell);
+    if (enemy == nullptr) return;
+
+    // The blows themselves come one exchange at a time, each combat tick
+    player << "\n";
+    if (player.weapon.has_value())
+        player << "You ready your " << items[player.weapon.value()].name;
+    else
+        player << "Empty-handed, you stand there passively";
+
+    player << " against a " << enemies[enemy->enemy].name << "! Move away to flee.\n";
+    player.foe = enemy->enemy;
+}
+
 void Game::PrintItems(Player& player, bool showIfEmpty)
 {
     const auto& itemIDs = areas[player.area]->GetItems(player.cell);
@@ -543,10 +830,29 @@ void Game::PrintItems(Player& player, bool showIfEmpty)
     }
 
     if (!showIfEmpty) player << "\n";
-    PrintItems(player, itemIDs);
+    PrintItems(player, itemIDs, areas[player.area]->GetItemTable(player.cell));
 }
 
 void Game::PrintItems(Player& player, const std::vector<ItemStack>& itemStacks)
+{
+    DrawItems(player.output, itemStacks);
+}
+
+void Game::PrintItems(Player& player, const std::vector<ItemStack>& itemStacks, ItemTable& table)
+{
+    // Only drawn again once the list's changed
+    if (table.IsStale())
+    {
+        Output drawn;
+        DrawItems(drawn, itemStacks);
+        table.text = std::make_shared<const std::string>(drawn.Take());
+        table.drawn = table.version;
+    }
+
+    player << table.text;
+}
+
+void Game::DrawItems(Output& output, const std::vector<ItemStack>& itemStacks)
 {
     // Dimensions
     std::pair<unsigned int, unsigned int> idWidth          = { 5,  10 }; // Current, maximum
@@ -588,20 +894,20 @@ void Game::PrintItems(Player& player, const std::vector<ItemStack>& itemStacks)
             countWidth.first = itemStack.number / 10;
     }
 
-    const auto PrintHeading = [&](const std::string& heading, const unsigned int width)
+    const auto PrintHeading = [&](const std::string_view heading, const unsigned int width)
     {
-        player << "| ";
+        output << "| ";
 
         if (heading.size() < width)
-            for (size_t i = 0; i < (width - heading.size()) / 2; ++i) player << " ";
+            output.Fill((width - heading.size()) / 2, ' ');
 
-        player << heading;
+        output << heading;
 
         // Funky maths to avoid the half flooring our value on odd widths
         if (heading.size() + 1 < width)
-            for (size_t i = 0; i < (width - heading.size() + 1) / 2; ++i) player << " ";
+            output.Fill((width - heading.size() + 1) / 2, ' ');
 
-        player << " ";
+        output << " ";
     };
 
     // Headings
@@ -612,13 +918,13 @@ void Game::PrintItems(Player& player, const std::vector<ItemStack>& itemStacks)
     PrintHeading("Defence", defenceWidth.first);
     PrintHeading("Price", priceWidth.first);
     PrintHeading("Count", countWidth.first);
-    player << "|\n";
+    output << "|\n";
 
     // The line under the headings
     const auto PrintLine = [&](const unsigned int width)
     {
-        player << "|";
-        for (unsigned int i = 0; i < width+2; ++i) player << "-";
+        output << "|";
+        output.Fill(width+2, '-');
     };
     
     PrintLine(idWidth.first);
@@ -628,32 +934,23 @@ void Game::PrintItems(Player& player, const std::vector<ItemStack>& itemStacks)
     PrintLine(defenceWidth.first);
     PrintLine(priceWidth.first);
     PrintLine(countWidth.first);
-    player << "|\n";
+    output << "|\n";
 
     // Data
-    const auto PrintString = [&](const std::string& string, const unsigned int maxWidth)
+    const auto PrintString = [&](const std::string_view string, const unsigned int maxWidth)
     {
         // Cut-off if too long
-        char shortened[maxWidth+1] = {};
-        if (string.size() > maxWidth)
-        {
-            strncpy(shortened, string.c_str(), maxWidth-3);
-            shortened[maxWidth - 1] = '.';
-            shortened[maxWidth - 2] = '.';
-            shortened[maxWidth - 3] = '.';
-        }
-        else strncpy(shortened, string.c_str(), string.size()+1); // +1 for null terminator
+        const bool cut = string.size() > maxWidth;
+        const size_t length = cut ? maxWidth : string.size();
 
         // Centre
-        const size_t length = strlen(shortened);
-        for (size_t i = 0; i < (maxWidth - length) / 2; ++i)
-            player << " ";
+        output.Fill((maxWidth - length) / 2, ' ');
 
-        player << shortened;
+        if (cut) output << string.substr(0, maxWidth - 3) << "...";
+        else output << string;
 
         // Centre again (funky maths, see above)
-        for (size_t i = 0; i < (maxWidth - length + 1) / 2; ++i)
-            player << " ";
+        output.Fill((maxWidth - length + 1) / 2, ' ');
     };
 
     for (size_t i = 0; i < itemStacks.size(); ++i)
@@ -665,159 +962,91 @@ void Game::PrintItems(Player& player, const std::vector<ItemStack>& itemStacks)
         const auto defence = items[itemStack.item].defence;
         const auto price = items[itemStack.item].price;
 
-        player << "| ";
-        PrintString(std::to_string(i+1), idWidth.first);                                 player << " | ";
-        PrintString(name, nameWidth.first);                                              player << " | ";
-        PrintString(description, descriptionWidth.first);                                player << " | ";
-        PrintString(attack > 1 ? std::to_string(attack) : "None", attackWidth.first);    player << " | ";
-        PrintString(defence > 0 ? std::to_string(defence) : "None", defenceWidth.first); player << " | ";
-        PrintString(std::to_string(price), priceWidth.first);                            player << " | ";
-        PrintString(std::to_string(itemStack.number), countWidth.first);
-        player << " |\n";
+        output << "| ";
+        PrintString(NumberText(i+1).View(), idWidth.first);                                     output << " | ";
+        PrintString(name, nameWidth.first);                                                     output << " | ";
+        PrintString(description, descriptionWidth.first);                                       output << " | ";
+        PrintString(attack > 1 ? NumberText(attack).View() : "None", attackWidth.first);        output << " | ";
+        PrintString(defence > 0 ? NumberText(defence).View() : "None", defenceWidth.first);     output << " | ";
+        PrintString(NumberText(price).View(), priceWidth.first);                                output << " | ";
+        PrintString(NumberText(itemStack.number).View(), countWidth.first);
+        output << " |\n";
     }
 }
 
-bool Game::OnCombat(Player& player, EnemyInstance& enemyInstance)
+bool Game::OnExchange(Player& player)
 {
-    const float damageVariation = 0.2f;
-    const int prefixChance = 50;
-    const int objectChance = 50;
-    bool playersTurn = true;
+    const auto& enemy = enemies[player.foe.value()];
+    EnemyInstance* enemyInstance = areas[player.area]->GetEnemy(player.cell);
 
-    if (player.weapon.has_value())
-        player << "You ready your " << items[player.weapon.value()].name << "";
-    else
-        player << "Empty-handed, you stand there passively";
-
-    const auto& enemy = enemies[enemyInstance.enemy];
-    player << " against a " << enemy.name << "!\n\n";
-
-    while (player.health > 0 && enemyInstance.health > 0)
+    // Somebody else sharing the cell may have finished it off first
+    if (enemyInstance == nullptr || enemyInstance->enemy != player.foe.value())
     {
-        const float variation = (
-            (float) rand() / (float) RAND_MAX //  0 to 1
-            * 2.0f - 1.0f                     // -1 to 1
-        )   * damageVariation + 1.0f;         // -whatever to +whatever
-
-        if (playersTurn && player.weapon.has_value())
-        {
-            player << "- ";
+        player << "The " << enemy.name << " has been slaughtered by another!\n";
+        player.foe.reset();
+        return true;
+    }
 
-            // Prefix
-            if (rand() % 100 <= prefixChance)
-            {
-                player << combatPrefixes[rand() % combatPrefixes.size()];
-                player << " you ";
-            }
-            else player << "You ";
-            
-            // Verb
-            player << attackVerbs[rand() % attackVerbs.size()] << " " ;
-
-            // Object
-            if (rand() % 100 <= objectChance)
-                player << combatObjects[rand() % combatObjects.size()];
-            else
-                player << "the " << enemy.name;
-            
-            player << ". ";
-
-            // Actually attack, plus or minus some variation
-            enemyInstance.health -= std::max(items[player.weapon.value()].attack * variation, 1.0f);
-            
-            // Work out how damaged the enemy is
-            float enemyHealthPercent = (float)enemyInstance.health / (float)enemy.maxHealth;
-
-            if (enemyHealthPercent > 0.6f)
-                player << attackMinimalDamageDescriptions[rand() % attackMinimalDamageDescriptions.size()];
-            
-            else if (enemyHealthPercent > 0.3f)
-                player << attackModerateDamageDescriptons[rand() % attackModerateDamageDescriptons.size()];
-                
-            else
-                player << attackMajorDamageDescriptions[rand() % attackMajorDamageDescriptions.size()];
+    // A blow each, with the player's first (so long as they've something to strike with)
+    for (const bool playersTurn : { true, false })
+    {
+        if (playersTurn && player.weapon.has_value()) OnAttack(player, *enemyInstance);
+        else OnDefend(player, *enemyInstance);
 
-            player << "\n";
-        }
+        if (!Combat::IsOver(player.health, enemyInstance->health)) continue;
 
-        else
-        {
-            player << "- ";
+        player << "\n";
 
-            // Prefix
-            if (rand() % 100 <= prefixChance)
-            {
-                player << combatPrefixes[rand() % combatPrefixes.size()];
+        // Print healths
+        player << "Your HP: " << player.health << "\n";
+        player << "The " << enemy.name << "'s HP: " << enemyInstance->health << "\n\n";
+        player.foe.reset();
 
-                // Object
-                if (rand() % 100 <= objectChance)
-                    player << " " << combatObjects[rand() % combatObjects.size()];
-                else
-                    player << " the " << enemy.name;
-            }
-            else
-            {
-                // As above but capitalise
-                if (rand() % 100 <= objectChance)
-                {
-                    std::string object = combatObjects[rand() % combatObjects.size()];
-                    object.data()[0] = toupper(object.data()[0]);
-                    player << object;
-                }
-                else
-                {
-                    player << "The " << enemy.name;
-                }
-            }
+        if (player.health < 0)
+        { 
+            player << "You have finally met a sticky end!\n";
+            return false;
+        }
 
-            // Verb
-            const auto& attack = enemy.attacks[rand() % enemy.attacks.size()];
-            const auto& verb = attack.verbs[rand() % attack.verbs.size()];
-            player << " " << verb << " you with its " << attack.limb << ". ";
-
-            // Actually attack, plus or minus some variation
-            float defence = 0.0f;
-            if (player.armour.has_value()) defence = items[player.armour.value()].defence;
-            player.health -= std::max(enemy.damage * variation - defence, 0.0f); // Avoid the player having so much defence they gain health!
-
-            // Damage message
-            const float damagePercent = (float) player.health / (float) MAX_PLAYER_HEALTH;
-
-            if (damagePercent > 0.6f)
-                player << defenceMinimalDamageDescriptions[rand() % defenceMinimalDamageDescriptions.size()];
-            
-            else if (damagePercent > 0.3f)
-                player << defenceModerateDamageDescriptons[rand() % defenceModerateDamageDescriptons.size()];
-                
-            else
-                player << defenceMajorDamageDescriptions[rand() % defenceMajorDamageDescriptions.size()];
+        player << "The " << enemy.name << " has been slaughtered!\n";
 
-            player << "\n";
-        }
+        // Bring the enemy back, good as new, after a while
+        const EnemyID enemyID = enemyInstance->enemy;
+        const AreaID area = player.area;
+        const Cell cell = player.cell;
+        areas[area]->DestroyEnemy(cell);
 
-        playersTurn = !playersTurn;
+        const uint64_t delay = (uint64_t) Config::Get().GetInt("enemy_respawn_delay", ENEMY_RESPAWN_DELAY) * 1000;
+        Simulation::Get().Schedule(delay, area, [this, enemyID, area, cell]() { areas[area]->SpawnEnemy(cell, enemyID, enemies[enemyID].maxHealth); });
+        return true;
     }
 
-    player << "\n";
+    return true;
+}
 
-    // Print healths
-    player << "Your HP: " << player.health << "\n";
-    player << "The " << enemy.name << "'s HP: " << enemyInstance.health << "\n\n";
+void Game::OnAttack(Player& player, EnemyInstance& enemyInstance)
+{
+    const auto& enemy = enemies[enemyInstance.enemy];
+    const float variation = Combat::GetVariation(player.random.NextFloat());
 
-    if (player.health < 0)
-    { 
-        player << "You have finally met a sticky end!\n";
-        return true;
-    }
+    // Actually attack, plus or minus some variation, then tell of it by how damaged the enemy is
+    enemyInstance.health = Combat::Wound(enemyInstance.health, Combat::GetAttackDamage<float>(items[player.weapon.value()].attack, variation));
+    narration.TellAttack(player.output, player.random, enemyInstance.enemy, (float) enemyInstance.health / (float) enemy.maxHealth);
+}
 
-    else
-    {
-        player << "The " << enemy.name << " has been slaughtered!\n";
-        return false;
-    }
+void Game::OnDefend(Player& player, EnemyInstance& enemyInstance)
+{
+    const auto& enemy = enemies[enemyInstance.enemy];
+    const float variation = Combat::GetVariation(player.random.NextFloat());
+
+    // As above, but the other way round
+    float defence = 0.0f;
+    if (player.armour.has_value()) defence = items[player.armour.value()].defence;
+    player.health = Combat::Wound(player.health, Combat::GetDefenceDamage<float>(enemy.damage, defence, variation));
+    narration.TellDefence(player.output, player.random, enemyInstance.enemy, (float) player.health / (float) MAX_PLAYER_HEALTH);
 }
 
 Game::~Game()
 {
     for (Area* area : areas) delete area;
-}
\ No newline at end of file
+}
@@ -0,0 +1,437 @@
+#include "HotRestart.h"
+#include "Config.h"
+#include "Game.h"
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define HANDOFF_VARIABLE "SLUDGE_HANDOFF_FD"
+#define HANDOFF_MAGIC 0x33474C53 // "SLG3"; bump whenever the format changes
+#define FDS_PER_MESSAGE 200      // Comfortably under the kernel's limit of 253
+#define CHUNK_SIZE 32768
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t listeners;
+    uint32_t sessions;
+    uint64_t size;
+};
+
+// Everything's passed between copies of the same program on the same
+// machine, so values go across exactly as they sit in memory
+class Writer
+{
+public:
+    template<typename T>
+    void Put(const T value) { data.append((const char*) &value, sizeof(value)); }
+
+    void Put(const std::string& string)
+    {
+        Put((uint32_t) string.size());
+        data.append(string);
+    }
+
+    std::string data;
+};
+
+class Reader
+{
+public:
+    Reader(const std::string& data) : failed(false), data(data), offset(0) {}
+
+    template<typename T>
+    T Get()
+    {
+        T value = {};
+        if (offset + sizeof(T) > data.size())
+        {
+            failed = true;
+            return value;
+        }
+
+        memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    std::string GetString()
+    {
+        const uint32_t size = Get<uint32_t>();
+        if (failed || offset + size > data.size())
+        {
+            failed = true;
+            return {};
+        }
+
+        offset += size;
+        return data.substr(offset - size, size);
+    }
+
+    bool failed;
+
+private:
+    const std::string& data;
+    size_t offset;
+};
+
+static std::string binaryPath;
+static std::vector<std::string> arguments;
+
+static void SetTimeout(const int channel)
+{
+    timeval timeout = {};
+    timeout.tv_sec = Config::Get().GetInt("restart_timeout", 30);
+    setsockopt(channel, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(channel, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static bool SendFds(const int channel, const int* fds, const size_t count)
+{
+    char marker = 'F';
+    iovec vector = { &marker, 1 };
+    char control[CMSG_SPACE(sizeof(int) * FDS_PER_MESSAGE)] = {};
+
+    msghdr message = {};
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(header), fds, sizeof(int) * count);
+
+    return sendmsg(channel, &message, MSG_NOSIGNAL) == 1;
+}
+
+static bool ReceiveFds(const int channel, std::vector<int>& fds)
+{
+    char marker;
+    iovec vector = { &marker, 1 };
+    char control[CMSG_SPACE(sizeof(int) * FDS_PER_MESSAGE)] = {};
+
+    msghdr message = {};
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if (recvmsg(channel, &message, MSG_CMSG_CLOEXEC) != 1 || (message.msg_flags & MSG_CTRUNC)) return false;
+
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+    {
+        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) continue;
+
+        const size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const int* received = (const int*) CMSG_DATA(header);
+        fds.insert(fds.end(), received, received + count);
+    }
+
+    return true;
+}
+
+void HotRestart::Prepare(char** argv)
+{
+    // Remember where the binary lives now, as once it's been replaced on disk
+    // /proc/self/exe only leads back to the old one
+    char path[4096];
+    const ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    binaryPath = length > 0 ? std::string(path, length) : std::string(argv[0]);
+    binaryPath = Config::Get().GetString("restart_binary", binaryPath);
+
+    for (char** argument = argv; *argument; ++argument)
+        arguments.emplace_back(*argument);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+void HotRestart::WaitForRequest()
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR2);
+
+    int signal;
+    while (sigwait(&signals, &signal) != 0 || signal != SIGUSR2);
+}
+
+int HotRestart::Launch()
+{
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) < 0)
+    {
+        perror("Unable to create restart channel");
+        return -1;
+    }
+
+    // Everything the child needs is made up front, as a threaded process
+    // mustn't do much more than exec once it's forked
+    std::vector<std::string> environment;
+    for (char** variable = environ; *variable; ++variable)
+    {
+        if (strncmp(*variable, HANDOFF_VARIABLE "=", strlen(HANDOFF_VARIABLE "=")) != 0)
+            environment.emplace_back(*variable);
+    }
+    environment.emplace_back(HANDOFF_VARIABLE "=" + std::to_string(pair[1]));
+
+    std::vector<char*> environmentPointers;
+    for (auto& variable : environment) environmentPointers.emplace_back(variable.data());
+    environmentPointers.emplace_back(nullptr);
+
+    std::vector<char*> argumentPointers;
+    for (auto& argument : arguments) argumentPointers.emplace_back(argument.data());
+    argumentPointers.emplace_back(nullptr);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+
+    std::cout << "Restarting " << binaryPath << std::endl;
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        // Only the child's end of the channel survives the exec
+        fcntl(pair[1], F_SETFD, 0);
+        pthread_sigmask(SIG_SETMASK, &signals, nullptr);
+        execve(binaryPath.c_str(), argumentPointers.data(), environmentPointers.data());
+        _exit(127);
+    }
+
+    close(pair[1]);
+    if (pid < 0)
+    {
+        perror("Unable to start new process");
+        close(pair[0]);
+        return -1;
+    }
+
+    // The new process says when it's loaded, so we carry on serving until then
+    SetTimeout(pair[0]);
+    char ready = 0;
+    if (recv(pair[0], &ready, 1, 0) != 1 || ready != 'R')
+    {
+        std::cerr << "New process never became ready, carrying on as we were" << std::endl;
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        close(pair[0]);
+        return -1;
+    }
+
+    return pair[0];
+}
+
+bool HotRestart::HandOver(const int channel, const Handoff& handoff)
+{
+    Writer writer;
+    std::vector<int> fds = handoff.serverFds;
+
+    // Players go across by item (and enemy) name rather than ID, in case they changed
+    const auto& items = Game::Get().items;
+    const auto& enemies = Game::Get().enemies;
+    writer.Put((uint32_t) Game::Get().players.Size());
+
+    Game::Get().players.ForEach([&](const Player& player)
+    {
+        writer.Put(player.name);
+        writer.Put(player.level);
+        writer.Put(player.area);
+        writer.Put(player.health);
+        writer.Put(player.money);
+        writer.Put(player.cell);
+        writer.Put(player.random.GetKey());
+        writer.Put(player.random.GetCounter());
+        writer.Put(player.weapon ? items[*player.weapon].name : std::string());
+        writer.Put(player.armour ? items[*player.armour].name : std::string());
+        writer.Put(player.foe ? enemies[*player.foe].name : std::string());
+        writer.Put(player.hibernated);
+        writer.Put(player.pinnedMap);
+        writer.Put(player.pendingCommands);
+        writer.Put(player.pendingBudget);
+
+        writer.Put((uint32_t) player.items.Size());
+        for (const auto& [item, number] : player.items)
+        {
+            writer.Put(items[item].name);
+            writer.Put(number);
+        }
+
+        writer.Put((uint32_t) player.aliases.size());
+        for (const auto& [name, commands] : player.aliases)
+        {
+            writer.Put(name);
+            writer.Put(commands);
+        }
+    });
+
+    for (size_t shard = 0; shard < handoff.sessions.size(); ++shard)
+    {
+        for (const auto& session : handoff.sessions[shard])
+        {
+            fds.emplace_back(session.fd);
+            writer.Put((uint32_t) shard);
+            writer.Put(session.address);
+            writer.Put((uint32_t) session.state);
+            writer.Put(session.player);
+            writer.Put(session.input);
+            writer.Put(session.unread);
+            writer.Put(session.output);
+            writer.Put(session.compressed);
+        }
+    }
+
+    Header header = { HANDOFF_MAGIC, (uint32_t) handoff.serverFds.size(), (uint32_t)(fds.size() - handoff.serverFds.size()), writer.data.size() };
+    bool success = send(channel, &header, sizeof(header), MSG_NOSIGNAL) == sizeof(header);
+
+    for (size_t i = 0; success && i < fds.size(); i += FDS_PER_MESSAGE)
+        success = SendFds(channel, fds.data() + i, std::min(fds.size() - i, (size_t) FDS_PER_MESSAGE));
+
+    for (size_t i = 0; success && i < writer.data.size(); i += CHUNK_SIZE)
+    {
+        const size_t size = std::min(writer.data.size() - i, (size_t) CHUNK_SIZE);
+        success = send(channel, writer.data.data() + i, size, MSG_NOSIGNAL) == (ssize_t) size;
+    }
+
+    // Only once the new process says it has everything is it safe to leave
+    char acknowledged = 0;
+    success = success && recv(channel, &acknowledged, 1, 0) == 1 && acknowledged == 'A';
+    if (!success) std::cerr << "Unable to hand over to new process, carrying on as we were" << std::endl;
+
+    close(channel);
+    return success;
+}
+
+bool HotRestart::IsResuming()
+{
+    return getenv(HANDOFF_VARIABLE) != nullptr;
+}
+
+bool HotRestart::Receive(Handoff& handoff)
+{
+    const int channel = std::stoi(getenv(HANDOFF_VARIABLE));
+    fcntl(channel, F_SETFD, FD_CLOEXEC);
+    unsetenv(HANDOFF_VARIABLE);
+    SetTimeout(channel);
+
+    // Tell the old process we're loaded, and it'll stop and send everything over
+    Header header = {};
+    std::vector<int> fds;
+    std::string data;
+
+    bool success = send(channel, "R", 1, MSG_NOSIGNAL) == 1 &&
+        recv(channel, &header, sizeof(header), 0) == sizeof(header) && header.magic == HANDOFF_MAGIC;
+
+    while (success && fds.size() < header.listeners + header.sessions)
+        success = ReceiveFds(channel, fds);
+
+    char chunk[CHUNK_SIZE];
+    while (success && data.size() < header.size)
+    {
+        const ssize_t size = recv(channel, chunk, sizeof(chunk), 0);
+        success = size > 0;
+        if (success) data.append(chunk, size);
+    }
+
+    if (!success || header.listeners == 0)
+    {
+        std::cerr << "Unable to take over from old process" << std::endl;
+        close(channel);
+        return false;
+    }
+
+    std::unordered_map<std::string, ItemID> itemIDs;
+    for (ItemID id = 0; id < Game::Get().items.size(); ++id)
+        itemIDs.emplace(Game::Get().items[id].name, id);
+
+    const auto FindItem = [&itemIDs](const std::string& name) -> std::optional<ItemID>
+    {
+        const auto it = itemIDs.find(name);
+        if (it == itemIDs.end()) return {};
+        return it->second;
+    };
+
+    const auto FindEnemy = [](const std::string& name) -> std::optional<EnemyID>
+    {
+        const auto& enemies = Game::Get().enemies;
+        for (EnemyID id = 0; id < enemies.size(); ++id)
+            if (enemies[id].name == name) return id;
+
+        return {};
+    };
+
+    Reader reader(data);
+    const uint32_t players = reader.Get<uint32_t>();
+
+    for (uint32_t i = 0; i < players && !reader.failed; ++i)
+    {
+        const std::string name = reader.GetString();
+        const auto level = reader.Get<unsigned int>();
+        const auto area = reader.Get<unsigned int>();
+
+        Player player(name, area, 0);
+        player.level = level;
+        player.health = reader.Get<int>();
+        player.money = reader.Get<int>();
+        player.cell = reader.Get<Cell>();
+        const auto key = reader.Get<uint64_t>();
+        player.random = Random::Resume(key, reader.Get<uint64_t>());
+        player.weapon = FindItem(reader.GetString());
+        player.armour = FindItem(reader.GetString());
+        player.foe = FindEnemy(reader.GetString());
+        player.hibernated = reader.Get<bool>();
+        player.pinnedMap = reader.Get<bool>();
+        player.pendingCommands = reader.GetString();
+        player.pendingBudget = reader.Get<unsigned int>();
+
+        const uint32_t stacks = reader.Get<uint32_t>();
+        for (uint32_t j = 0; j < stacks && !reader.failed; ++j)
+        {
+            const auto item = FindItem(reader.GetString());
+            const auto number = reader.Get<unsigned int>();
+            if (item) player.items.Add(*item, number);
+        }
+
+        const uint32_t aliases = reader.Get<uint32_t>();
+        for (uint32_t j = 0; j < aliases && !reader.failed; ++j)
+        {
+            std::string name = reader.GetString();
+            player.aliases[std::move(name)] = reader.GetString();
+        }
+
+        Game::Get().players.Reserve(std::move(player));
+    }
+
+    handoff.serverFds.assign(fds.begin(), fds.begin() + header.listeners);
+    handoff.sessions.resize(header.listeners);
+
+    for (uint32_t i = 0; i < header.sessions && !reader.failed; ++i)
+    {
+        Connection::Snapshot session;
+        const uint32_t shard = reader.Get<uint32_t>();
+        session.fd = fds[header.listeners + i];
+        session.address = reader.GetString();
+        session.state = (Connection::State) reader.Get<uint32_t>();
+        session.player = reader.GetString();
+        session.input = reader.GetString();
+        session.unread = reader.GetString();
+        session.output = reader.GetString();
+        session.compressed = reader.Get<bool>();
+
+        handoff.sessions[shard % header.listeners].emplace_back(std::move(session));
+    }
+
+    if (reader.failed) std::cerr << "Handoff from old process was cut short" << std::endl;
+
+    send(channel, "A", 1, MSG_NOSIGNAL);
+    close(channel);
+
+    std::cout << "Took over " << header.sessions << " session(s) and " << players << " player(s)" << std::endl;
+    return true;
+}
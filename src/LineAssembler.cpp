@@ -0,0 +1,111 @@
+#include "LineAssembler.h"
+
+LineAssembler::LineAssembler() : head(0), count(0), lines(0), partialLength(0), discarding(false) {}
+
+size_t LineAssembler::Append(const char* data, const size_t size)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        const char* newline = (const char*) memchr(data + i, '\n', size - i);
+        const size_t end = newline ? newline - data + 1 : size;
+
+        // Still skipping the remainder of an overly long line
+        if (discarding)
+        {
+            if (newline) discarding = false;
+            i = end;
+            continue;
+        }
+
+        // Cut the line off if it's grown too long, and skip whatever's left of it
+        const size_t length = end - i - (newline ? 1 : 0);
+        if (partialLength + length > MAX_LINE_LENGTH)
+        {
+            const size_t allowed = MAX_LINE_LENGTH - partialLength;
+            if (allowed + 1 > Free()) return i;
+
+            Push(data + i, allowed);
+            Push("\n", 1);
+
+            discarding = (newline == nullptr);
+            i = end;
+            continue;
+        }
+
+        if (!Push(data + i, end - i)) return i;
+        i = end;
+    }
+
+    return size;
+}
+
+bool LineAssembler::Push(const char* data, const size_t size)
+{
+    if (size == 0) return true;
+    if (size > Free()) return false;
+
+    // Idle clients never need a buffer, so only make one once there's something to hold
+    if (!buffer) buffer = std::make_unique<char[]>(INPUT_BUFFER_SIZE);
+
+    // Copy in, in (at most) two pieces either side of the wrap-around
+    const size_t tail = (head + count) & (INPUT_BUFFER_SIZE - 1);
+    const size_t first = std::min(size, INPUT_BUFFER_SIZE - tail);
+    memcpy(buffer.get() + tail, data, first);
+    memcpy(buffer.get(), data + first, size - first);
+    count += size;
+
+    // Only a newline as the final byte can end a line here (see Append)
+    if (data[size - 1] == '\n')
+    {
+        lines++;
+        partialLength = 0;
+    }
+    else partialLength += size;
+
+    return true;
+}
+
+bool LineAssembler::Pop(std::string& line)
+{
+    line.clear();
+    if (lines == 0) return false;
+
+    // Look for the newline in up to two contiguous pieces
+    const size_t first = std::min(count, INPUT_BUFFER_SIZE - head);
+    const char* start = buffer.get() + head;
+    const char* newline = (const char*) memchr(start, '\n', first);
+    size_t length;
+
+    if (newline)
+    {
+        length = newline - start;
+        line.append(start, length);
+    }
+    else
+    {
+        newline = (const char*) memchr(buffer.get(), '\n', count - first);
+        length = first + (newline - buffer.get());
+        line.append(start, first);
+        line.append(buffer.get(), newline - buffer.get());
+    }
+
+    head = (head + length + 1) & (INPUT_BUFFER_SIZE - 1);
+    count -= length + 1;
+    lines--;
+
+    // Telnet clients end lines with "\r\n"
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+std::string LineAssembler::Contents() const
+{
+    std::string contents;
+    if (count == 0) return contents;
+
+    const size_t first = std::min(count, INPUT_BUFFER_SIZE - head);
+    contents.append(buffer.get() + head, first);
+    contents.append(buffer.get(), count - first);
+    return contents;
+}
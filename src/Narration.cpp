@@ -0,0 +1,103 @@
+#include "Narration.h"
+
+// Blows come with a prefix, or an object in place of the enemy, this often (in 100)
+#define COMBAT_PREFIX_CHANCE 50
+#define COMBAT_OBJECT_CHANCE 50
+
+void Narration::Load(const std::vector<Enemy>& enemyList)
+{
+    const auto prefixes = ReadLines("combat/prefixes.txt");
+    const auto objects = ReadLines("combat/objects.txt");
+
+    attackHead = Add("- You ", "", "");
+    attackHeads = Add("- ", prefixes, " you ");
+    attackVerbs = Add("", ReadLines("combat/attack/verbs.txt"), " ");
+    attackObjects = Add("", objects, ". ");
+    attackDamages[Minimal] = Add("", ReadLines("combat/attack/minimal_damages.txt"), "\n");
+    attackDamages[Moderate] = Add("", ReadLines("combat/attack/moderate_damages.txt"), "\n");
+    attackDamages[Major] = Add("", ReadLines("combat/attack/major_damages.txt"), "\n");
+
+    defenceHead = Add("- ", "", "");
+    defenceHeads = Add("- ", prefixes, " ");
+    defenceObjects = Add("", objects, " ");
+    capitalisedObjects = Add("", objects, " ", true);
+    defenceDamages[Minimal] = Add("", ReadLines("combat/defence/minimal_damages.txt"), "\n");
+    defenceDamages[Moderate] = Add("", ReadLines("combat/defence/moderate_damages.txt"), "\n");
+    defenceDamages[Major] = Add("", ReadLines("combat/defence/major_damages.txt"), "\n");
+
+    for (const Enemy& enemy : enemyList)
+    {
+        EnemyPhrases enemyPhrases;
+        enemyPhrases.attackObject = Add("the ", enemy.name, ". ");
+        enemyPhrases.defenceObject = Add("the ", enemy.name, " ");
+        enemyPhrases.capitalisedObject = Add("The ", enemy.name, " ");
+
+        for (const auto& attack : enemy.attacks)
+            enemyPhrases.attacks.push_back(Add("", attack.verbs, " you with its " + attack.limb + ". "));
+
+        enemies.push_back(enemyPhrases);
+    }
+}
+
+void Narration::TellAttack(Output& output, Random& random, const EnemyID enemy, const float health) const
+{
+    const EnemyPhrases& enemyPhrases = enemies[enemy];
+
+    const std::string_view head = random.Below(100) <= COMBAT_PREFIX_CHANCE ? Pick(random, attackHeads) : Get(attackHead);
+    const std::string_view verb = Pick(random, attackVerbs);
+    const std::string_view object = random.Below(100) <= COMBAT_OBJECT_CHANCE ? Pick(random, attackObjects) : Get(enemyPhrases.attackObject);
+    const std::string_view damage = Pick(random, attackDamages[GetDamage(health)]);
+
+    output.Write({ head, verb, object, damage });
+}
+
+void Narration::TellDefence(Output& output, Random& random, const EnemyID enemy, const float health) const
+{
+    const EnemyPhrases& enemyPhrases = enemies[enemy];
+    const bool prefixed = random.Below(100) <= COMBAT_PREFIX_CHANCE;
+    const bool object = random.Below(100) <= COMBAT_OBJECT_CHANCE;
+
+    // Only capitalised when it starts the sentence
+    const std::string_view head = prefixed ? Pick(random, defenceHeads) : Get(defenceHead);
+    const std::string_view subject = prefixed ?
+        (object ? Pick(random, defenceObjects) : Get(enemyPhrases.defenceObject)) :
+        (object ? Pick(random, capitalisedObjects) : Get(enemyPhrases.capitalisedObject));
+
+    const std::string_view verb = Pick(random, enemyPhrases.attacks[random.Below(enemyPhrases.attacks.size())]);
+    const std::string_view damage = Pick(random, defenceDamages[GetDamage(health)]);
+
+    output.Write({ head, subject, verb, damage });
+}
+
+Narration::Phrase Narration::Add(const std::string_view before, const std::string_view phrase, const std::string_view after, const bool capitalised)
+{
+    const Phrase added = { (uint32_t) text.size(), (uint32_t) (before.size() + phrase.size() + after.size()) };
+    text += before;
+    text += phrase;
+    text += after;
+
+    if (capitalised && !phrase.empty())
+        text[added.offset + before.size()] = toupper(phrase[0]);
+
+    phrases.push_back(added);
+    return added;
+}
+
+Narration::List Narration::Add(const std::string_view before, const std::vector<std::string>& list, const std::string_view after, const bool capitalised)
+{
+    List added;
+    added.first = phrases.size();
+
+    for (const auto& phrase : list) Add(before, phrase, after, capitalised);
+    if (list.empty()) Add(before, std::string_view(), after);
+
+    added.size = phrases.size() - added.first;
+    return added;
+}
+
+Narration::Damage Narration::GetDamage(const float health)
+{
+    if (health > 0.6f) return Minimal;
+    else if (health > 0.3f) return Moderate;
+    else return Major;
+}
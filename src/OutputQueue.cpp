@@ -0,0 +1,98 @@
+#include "OutputQueue.h"
+
+// Strings shorter than this are packed in with their neighbours
+#define PACK_LIMIT 512
+
+void OutputQueue::Append(std::string_view string)
+{
+    if (string.empty()) return;
+
+    if (!CanPack()) segments.emplace_back();
+    segments.back().owned.append(string);
+    size += string.size();
+}
+
+void OutputQueue::Append(std::string&& string)
+{
+    if (string.size() < PACK_LIMIT)
+    {
+        Append(std::string_view(string));
+        return;
+    }
+
+    size += string.size();
+    segments.emplace_back();
+    segments.back().owned = std::move(string);
+}
+
+void OutputQueue::Append(const std::shared_ptr<const std::string>& string)
+{
+    if (string->empty()) return;
+
+    size += string->size();
+    segments.emplace_back();
+    segments.back().shared = string;
+}
+
+int OutputQueue::Gather(iovec* vectors, const int maxVectors, const bool inFlight)
+{
+    int count = 0;
+    for (size_t i = 0; i < segments.size() && count < maxVectors; ++i)
+    {
+        auto view = segments[i].View();
+        if (i == 0) view.remove_prefix(frontOffset);
+
+        vectors[count].iov_base = (void*) view.data();
+        vectors[count].iov_len = view.size();
+        count++;
+    }
+
+    // Whatever's been handed out to be sent later must now stay exactly where it is
+    if (inFlight) sealed = count;
+    return count;
+}
+
+void OutputQueue::Consume(size_t bytes)
+{
+    size -= bytes;
+
+    // The send's done with, however much of it went
+    sealed = 0;
+
+    while (bytes > 0 && !segments.empty())
+    {
+        const size_t remaining = segments.front().View().size() - frontOffset;
+        if (bytes < remaining)
+        {
+            frontOffset += bytes;
+            return;
+        }
+
+        bytes -= remaining;
+        segments.pop_front();
+        frontOffset = 0;
+    }
+}
+
+std::string OutputQueue::Contents() const
+{
+    std::string contents;
+    contents.reserve(size);
+
+    for (size_t i = 0; i < segments.size(); ++i)
+        contents.append(segments[i].View().substr(i == 0 ? frontOffset : 0));
+
+    return contents;
+}
+
+void OutputQueue::DropUnsent()
+{
+    // Including whatever was left of one partly sent
+    while (segments.size() > sealed)
+    {
+        size -= segments.back().View().size() - (segments.size() == 1 ? frontOffset : 0);
+        segments.pop_back();
+    }
+
+    if (segments.empty()) frontOffset = 0;
+}
@@ -0,0 +1,128 @@
+#include "PlayerRegistry.h"
+
+// Starting size of each shard's table, which doubles whenever it's half full
+#define PLAYER_TABLE_CAPACITY 16
+
+// Low bits of a name's hash choose the shard, the next ones its place in the
+// shard's table, and the top ones are kept in the entry as a tag
+static size_t GetShard(const size_t hash) { return hash % PLAYER_REGISTRY_SHARDS; }
+static size_t GetSlot(const size_t hash) { return hash / PLAYER_REGISTRY_SHARDS; }
+static uint64_t GetTag(const size_t hash) { return (uint64_t) hash & 0xffffffff00000000; }
+
+PlayerRegistry::PlayerRegistry() : count(0)
+{
+    for (auto& shard : shards)
+        shard.table.store(new Table(PLAYER_TABLE_CAPACITY), std::memory_order_relaxed);
+
+    for (auto& chunk : chunks)
+        chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+Player* PlayerRegistry::Reserve(Player&& player)
+{
+    const size_t hash = std::hash<std::string>()(player.name);
+    Shard& shard = shards[GetShard(hash)];
+
+    // Only those claiming names in the same shard ever wait on each other
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Table* table = shard.table.load(std::memory_order_relaxed);
+    if (Find(*table, hash, player.name) != nullptr) return nullptr;
+
+    if ((shard.size + 1) * 2 > table->mask + 1)
+    {
+        // Readers carry on in the old table until the new one's swapped in
+        Table* grown = new Table((table->mask + 1) * 2);
+        for (size_t i = 0; i <= table->mask; ++i)
+        {
+            const uint64_t entry = table->entries[i].load(std::memory_order_relaxed);
+            if (entry == 0) continue;
+
+            const Handle handle = (Handle) (entry & 0xffffffff) - 1;
+            Insert(*grown, std::hash<std::string>()(Get(handle)->name), entry);
+        }
+
+        shard.outgrown.push_back(table);
+        shard.table.store(grown, std::memory_order_release);
+        table = grown;
+    }
+
+    // Made before it's published, so nobody finds it half-built
+    Handle handle;
+    Player* added = Allocate(std::move(player), handle);
+    if (added == nullptr) return nullptr;
+
+    Insert(*table, hash, GetTag(hash) | (handle + 1));
+    shard.size++;
+    return added;
+}
+
+Player* PlayerRegistry::Find(const std::string& name) const
+{
+    const size_t hash = std::hash<std::string>()(name);
+    const Table* table = shards[GetShard(hash)].table.load(std::memory_order_acquire);
+    return Find(*table, hash, name);
+}
+
+Player* PlayerRegistry::Find(const Table& table, const size_t hash, const std::string& name) const
+{
+    const uint64_t tag = GetTag(hash);
+    for (size_t i = GetSlot(hash); ; ++i)
+    {
+        const uint64_t entry = table.entries[i & table.mask].load(std::memory_order_acquire);
+        if (entry == 0) return nullptr;
+        if ((entry & 0xffffffff00000000) != tag) continue;
+
+        Player* player = Get((Handle) (entry & 0xffffffff) - 1);
+        if (player->name == name) return player;
+    }
+}
+
+void PlayerRegistry::Insert(Table& table, const size_t hash, const uint64_t entry)
+{
+    // Tables are never more than half full, so there's always a gap
+    size_t i = GetSlot(hash);
+    while (table.entries[i & table.mask].load(std::memory_order_relaxed) != 0) i++;
+    table.entries[i & table.mask].store(entry, std::memory_order_release);
+}
+
+Player* PlayerRegistry::Allocate(Player&& player, Handle& handle)
+{
+    handle = count.load(std::memory_order_relaxed);
+    do
+    {
+        if ((handle >> PLAYER_CHUNK_BITS) >= PLAYER_MAX_CHUNKS)
+        {
+            std::cerr << "Player registry full" << std::endl;
+            return nullptr;
+        }
+    }
+    while (!count.compare_exchange_weak(handle, handle + 1, std::memory_order_acq_rel));
+
+    const size_t chunk = handle >> PLAYER_CHUNK_BITS;
+
+    // Whoever first needs a chunk makes it; anybody else racing to do the same
+    // throws theirs away
+    if (chunks[chunk].load(std::memory_order_acquire) == nullptr)
+    {
+        Player* fresh = static_cast<Player*>(::operator new(sizeof(Player) * PLAYER_CHUNK_SIZE));
+        Player* expected = nullptr;
+        if (!chunks[chunk].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel))
+            ::operator delete(fresh);
+    }
+
+    return new (Get(handle)) Player(std::move(player));
+}
+
+PlayerRegistry::~PlayerRegistry()
+{
+    ForEach([](Player& player) { player.~Player(); });
+
+    for (auto& chunk : chunks)
+        ::operator delete(chunk.load());
+
+    for (auto& shard : shards)
+    {
+        delete shard.table.load();
+        for (Table* table : shard.outgrown) delete table;
+    }
+}
@@ -0,0 +1,174 @@
+#include "PlayerStore.h"
+#include "Config.h"
+#include "Game.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const std::unordered_map<std::string, ItemID>& GetItemIDs()
+{
+    static const std::unordered_map<std::string, ItemID> itemIDs = []()
+    {
+        std::unordered_map<std::string, ItemID> itemIDs;
+        const auto& items = Game::Get().items;
+        for (ItemID i = 0; i < items.size(); ++i) itemIDs.emplace(items[i].name, i);
+        return itemIDs;
+    }();
+
+    return itemIDs;
+}
+
+static std::optional<ItemID> FindItem(const std::string& name)
+{
+    const auto& itemIDs = GetItemIDs();
+    const auto it = itemIDs.find(name);
+    if (it == itemIDs.end()) return {};
+    return it->second;
+}
+
+std::string PlayerStore::GetPath(const std::string& name)
+{
+    const std::string directory = "../data/" + Config::Get().GetString("player_directory", "players") + "/";
+    if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST)
+        perror("Unable to create player directory");
+
+    // Names may hold anything, so all but the plainest characters are escaped
+    std::string path = directory;
+    for (const unsigned char c : name)
+    {
+        if (isalnum(c) || c == '_' || c == '-') path += c;
+        else
+        {
+            char escaped[4];
+            snprintf(escaped, sizeof(escaped), "%%%02X", c);
+            path += escaped;
+        }
+    }
+
+    return path + ".txt";
+}
+
+bool PlayerStore::Hibernate(Player& player)
+{
+    const auto& items = Game::Get().items;
+    const std::string path = GetPath(player.name);
+
+    // Written alongside, then moved over the old file, so a crash midway loses nothing
+    {
+        std::ofstream file(path + ".new", std::ios::trunc);
+        file << "level " << player.level << "\n";
+        file << "area " << player.area << "\n";
+        file << "health " << player.health << "\n";
+        file << "money " << player.money << "\n";
+        file << "cell " << player.cell << "\n";
+        file << "random " << player.random.GetKey() << " " << player.random.GetCounter() << "\n";
+        if (player.weapon) file << "weapon " << items[*player.weapon].name << "\n";
+        if (player.armour) file << "armour " << items[*player.armour].name << "\n";
+
+        for (const auto& [item, number] : player.items)
+            file << "item " << number << " " << items[item].name << "\n";
+
+        for (const auto& [name, commands] : player.aliases)
+            file << "alias " << name << " " << commands << "\n";
+
+        file.flush();
+        if (file.fail())
+        {
+            std::cerr << "Unable to hibernate " << player.name << std::endl;
+            unlink((path + ".new").c_str());
+            return false;
+        }
+    }
+
+    if (rename((path + ".new").c_str(), path.c_str()) < 0)
+    {
+        perror("Unable to hibernate player");
+        return false;
+    }
+
+    // Swapped out rather than cleared, so the memory really goes
+    player.items.Release();
+    player.output.Release();
+    decltype(player.aliases)().swap(player.aliases);
+    player.weapon.reset();
+    player.armour.reset();
+    player.hibernated = true;
+    return true;
+}
+
+bool PlayerStore::Revive(Player& player)
+{
+    player.hibernated = false;
+
+    std::ifstream file(GetPath(player.name));
+    if (file.fail())
+    {
+        std::cerr << "Unable to revive " << player.name << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::string key;
+        stream >> key;
+        stream.get();
+
+        if (key == "level") stream >> player.level;
+        else if (key == "area") stream >> player.area;
+        else if (key == "health") stream >> player.health;
+        else if (key == "money") stream >> player.money;
+        else if (key == "cell") stream >> player.cell;
+
+        else if (key == "random")
+        {
+            uint64_t streamKey = 0, counter = 0;
+            stream >> streamKey >> counter;
+            player.random = Random::Resume(streamKey, counter);
+        }
+
+        else if (key == "weapon" || key == "armour")
+        {
+            std::string name;
+            std::getline(stream, name);
+            (key == "weapon" ? player.weapon : player.armour) = FindItem(name);
+        }
+
+        else if (key == "item")
+        {
+            unsigned int number = 0;
+            std::string name;
+            stream >> number;
+            stream.get();
+            std::getline(stream, name);
+
+            const auto item = FindItem(name);
+            if (item) player.items.Add(*item, number);
+        }
+
+        else if (key == "alias")
+        {
+            std::string name, commands;
+            std::getline(stream, name, ' ');
+            std::getline(stream, commands);
+            player.aliases[name] = commands;
+        }
+    }
+
+    // Only a change of seed could have taken their area away
+    if (player.area >= Game::Get().areas.size())
+    {
+        player.area = 0;
+        player.cell = Game::Get().areas[0]->GetStartingCell();
+    }
+
+    return true;
+}
+
+void PlayerStore::Forget(const Player& player)
+{
+    const std::string path = GetPath(player.name);
+    if (unlink(path.c_str()) < 0 && errno != ENOENT)
+        perror("Unable to forget player");
+}
@@ -0,0 +1,516 @@
+#include "Simulation.h"
+#include "EventLoop.h"
+#include "Config.h"
+#include "Game.h"
+#include "PlayerStore.h"
+#include "WorkerPool.h"
+
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define TIMER_TICK_MS 50
+#define RECONNECT_GRACE 300
+#define COMBAT_TICK_MS 1000
+#define COMBAT_EXCHANGES_PER_TICK 64
+
+Simulation::Simulation() :
+    absences(0), grace(Config::Get().GetInt("reconnect_grace", RECONNECT_GRACE) * 1000),
+    combatTick(Config::Get().GetInt("combat_tick_ms", COMBAT_TICK_MS)),
+    combatExchanges(std::max(Config::Get().GetInt("combat_exchanges_per_tick", COMBAT_EXCHANGES_PER_TICK), 1)),
+    connected(0), waiting(0), hibernated(0),
+    timers(Config::Get().GetInt("timer_tick_ms", TIMER_TICK_MS)), sleeping(false)
+{
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0)
+    {
+        perror("Unable to create simulation wake event");
+        exit(-1);
+    }
+}
+
+void Simulation::Start()
+{
+    // Every area gets a strand of its own
+    for (size_t i = 0; i < Game::Get().areas.size(); ++i)
+    {
+        strands.emplace_back(std::make_unique<Strand>());
+        battles.emplace_back(std::make_unique<Battle>());
+    }
+
+    for (size_t i = 0; i < WorkerPool::Get().Size(); ++i)
+    {
+        latencies.emplace_back(std::make_unique<Latency>());
+        gates.emplace_back(std::make_unique<Strand>());
+    }
+
+    // Nobody has a session yet, so everybody carried over from a restart starts
+    // out absent, and is claimed again as their session resumes
+    Game::Get().players.ForEach([this](Player& player)
+    {
+        const uint64_t id = ++absences;
+        absent[&player] = { id, false };
+
+        if (player.hibernated) hibernated++;
+        else
+        {
+            waiting++;
+            Schedule(grace, lobby, [this, &player, id]() { Expire(player, id); });
+        }
+    });
+
+    std::cout << "Simulation running " << strands.size() << " strand(s) on " << WorkerPool::Get().Size() << " worker(s)" << std::endl;
+    thread = std::thread([this]() { Run(); });
+}
+
+void Simulation::Post(Command&& command)
+{
+    command.posted = std::chrono::steady_clock::now();
+
+    // The session holds onto its own commands, so they don't hold onto it
+    std::shared_ptr<Session> session = std::move(command.session);
+    session->commands.Push(std::move(command));
+
+    // Only the first to find the session idle sends it to its strand, and as
+    // whoever ran it last let go of it first, its strand is safe to look at
+    if (!session->scheduled.exchange(true))
+    {
+        if (session->strand == nullptr) session->strand = GetGate(*session);
+        session->strand->Post([this, session]() { Serve(session); });
+    }
+}
+
+void Simulation::Schedule(const uint64_t delay, const AreaID area, Strand::Task task)
+{
+    Schedule(delay, *strands[area], std::move(task));
+}
+
+void Simulation::Schedule(const uint64_t delay, Strand& strand, Strand::Task task)
+{
+    pendingTimers.Push({ delay, &strand, std::move(task) });
+
+    // Only the first to find the simulation asleep needs to wake it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.exchange(false)) Wake();
+}
+
+void Simulation::Wake()
+{
+    const uint64_t value = 1;
+    if (write(wakeFd, &value, sizeof(value)) < 0)
+        perror("Unable to wake simulation");
+}
+
+void Simulation::Pause()
+{
+    // Nothing new comes in once the loops have stopped, so the strands run dry; timers
+    // may still come due, but what they post waits until we're resumed
+    WorkerPool::Get().Pause();
+}
+
+void Simulation::Resume()
+{
+    WorkerPool::Get().Resume();
+}
+
+void Simulation::Run()
+{
+    const int interval = Config::Get().GetInt("simulation_report_interval", 60);
+    if (interval > 0) timers.Schedule(interval * 1000, [this, interval]() { Report(interval); });
+
+    while (1)
+    {
+        // Game events come due on this thread, but run on their area's strand
+        Timer timer;
+        while (pendingTimers.Pop(timer))
+        {
+            Strand* strand = timer.strand;
+            timers.Schedule(timer.delay, [strand, task = std::move(timer.task)]() mutable { strand->Post(std::move(task)); });
+        }
+
+        timers.Advance();
+        Sleep(timers.GetTimeout());
+    }
+}
+
+void Simulation::Sleep(const int timeout)
+{
+    // We only sleep once we've seen nothing's waiting, and producers only skip waking
+    // us if they see we're awake, so between us nothing gets left behind
+    sleeping = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (pendingTimers.Empty())
+    {
+        pollfd wake = { wakeFd, POLLIN, 0 };
+        poll(&wake, 1, timeout);
+
+        uint64_t value;
+        while (read(wakeFd, &value, sizeof(value)) > 0);
+    }
+
+    sleeping = false;
+}
+
+void Simulation::Serve(const std::shared_ptr<Session>& session)
+{
+    Strand* strand = session->strand;
+
+    // A player taken over mid-fight from the old process rejoins the fight here
+    if (session->player && session->player->foe.has_value() != session->fighting) Muster(session, session->player->area);
+
+    Command command;
+    while (1)
+    {
+        // A command that crossed into this area (or that's waited on the lobby) is
+        // finished before any others start
+        if (session->arriving) Arrive(session);
+        else if (session->claim)
+        {
+            command = std::move(*session->claim);
+            session->claim.reset();
+            Execute(session, command);
+        }
+        else if (session->commands.Pop(command)) Execute(session, command);
+        else break;
+
+        // Having moved to an area on another strand, the session (and with it the
+        // rest of the command, and any others waiting) is handed over
+        if (session->strand != strand)
+        {
+            session->strand->Post([this, session]() { Serve(session); });
+            return;
+        }
+    }
+
+    // As with strands, anything posted whilst we were letting go is ours to pick up
+    session->scheduled = false;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!session->commands.Empty() && !session->scheduled.exchange(true))
+        session->strand->Post([this, session]() { Serve(session); });
+}
+
+void Simulation::Execute(const std::shared_ptr<Session>& session, Command& command)
+{
+    switch (command.type)
+    {
+        case Command::Login:
+        {
+            Player* player = Game::Get().GetPlayer(command.text);
+
+            // New names are claimed right here on the session's gate, in parallel with
+            // every other gate; players who already exist belong to the lobby
+            if (player != nullptr && session->strand != &lobby)
+            {
+                session->claim = std::move(command);
+                break;
+            }
+
+            if (player == nullptr)
+            {
+                session->player = Game::Get().AddPlayer(command.text);
+                if (session->player == nullptr) SendReply(session, Reply::NameTaken, {});
+                else
+                {
+                    connected++;
+                    SendReply(session, Reply::LoggedIn, std::move(command.text));
+                }
+            }
+
+            // Taking back a player who left, unless they're still in use
+            else
+            {
+                const auto it = absent.find(player);
+                const bool evicted = it != absent.end() && it->second.evicted;
+
+                if (!Claim(*player)) SendReply(session, Reply::NameTaken, {});
+                else
+                {
+                    session->player = player;
+                    SendReply(session, evicted ? Reply::LoggedIn : Reply::Reconnected, std::move(command.text));
+                }
+            }
+        }
+        break;
+
+        case Command::Resume:
+        {
+            Player* player = Game::Get().GetPlayer(command.text);
+
+            if (player != nullptr && session->strand != &lobby)
+            {
+                session->claim = std::move(command);
+                break;
+            }
+
+            if (player == nullptr || !Claim(*player)) SendReply(session, Reply::Farewell, "Your character was lost in the restart; farewell!\n");
+            else
+            {
+                // And one who was partway through a batch that crossed areas finishes it
+                session->player = player;
+                session->arriving = !player->pendingCommands.empty();
+                SendReply(session, Reply::Resumed, {});
+            }
+        }
+        break;
+
+        case Command::Line:
+        {
+            // The dead (killed in a fight between commands) say no more
+            if (session->player == nullptr || session->player->health < 0) break;
+
+            Player& player = *session->player;
+            const AreaID area = player.area;
+            const bool alive = Game::Get().OnCommand(command.text, player);
+
+            if (!alive) player.foe.reset();
+            Muster(session, area);
+
+            if (alive && player.area != area) session->arriving = true;
+            else SendOutput(session, alive);
+        }
+        break;
+
+        // The player's no longer ours, but the lobby's, to keep for a while
+        case Command::Disconnect:
+            if (session->player != nullptr)
+            {
+                // Whoever leaves mid-fight leaves the fight too
+                Player* player = session->player;
+                player->foe.reset();
+                Muster(session, player->area);
+
+                lobby.Post([this, player]() { Detach(*player); });
+                session->player = nullptr;
+            }
+        break;
+    }
+
+    // Follow the player to whichever area they're now in, or wait on the lobby for them
+    if (session->player) session->strand = strands[session->player->area].get();
+    else session->strand = session->claim ? &lobby : GetGate(*session);
+
+    // Counted once it's run for good
+    if (session->claim) return;
+
+    const uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - command.posted).count();
+    Latency& stats = *latencies[WorkerPool::GetWorkerIndex()];
+    stats.executed.fetch_add(1, std::memory_order_relaxed);
+    stats.total.fetch_add(latency, std::memory_order_relaxed);
+    if (latency > stats.max.load(std::memory_order_relaxed)) stats.max.store(latency, std::memory_order_relaxed);
+}
+
+bool Simulation::Claim(Player& player)
+{
+    const auto it = absent.find(&player);
+    if (it == absent.end()) return false;
+
+    // Whatever timer's still out for them will find their absence gone
+    if (!it->second.evicted)
+    {
+        if (player.hibernated)
+        {
+            hibernated--;
+            PlayerStore::Revive(player);
+        }
+        else waiting--;
+    }
+
+    absent.erase(it);
+    connected++;
+
+    // Whatever was on their old screen isn't on their new one
+    player.shownMap.clear();
+    return true;
+}
+
+void Simulation::Detach(Player& player)
+{
+    connected--;
+    const uint64_t id = ++absences;
+
+    // The dead don't come back, so only their name's kept, for whoever next takes it
+    if (player.health < 0)
+    {
+        PlayerStore::Forget(player);
+        player.Reset(0, Game::Get().areas[0]->GetStartingCell(), Game::Get().MakeRandom(player.name));
+        absent[&player] = { id, true };
+        return;
+    }
+
+    absent[&player] = { id, false };
+    waiting++;
+    Schedule(grace, lobby, [this, &player, id]() { Expire(player, id); });
+}
+
+void Simulation::Expire(Player& player, const uint64_t id)
+{
+    // Only if they've stayed away since this timer was set
+    const auto it = absent.find(&player);
+    if (it == absent.end() || it->second.id != id || it->second.evicted) return;
+
+    if (PlayerStore::Hibernate(player))
+    {
+        waiting--;
+        hibernated++;
+    }
+}
+
+void Simulation::Arrive(const std::shared_ptr<Session>& session)
+{
+    // What's left of a batch of commands may take the player on again
+    Player& player = *session->player;
+    const AreaID area = player.area;
+    const bool alive = Game::Get().OnArrival(player);
+
+    if (!alive) player.foe.reset();
+    Muster(session, area);
+
+    session->arriving = alive && player.area != area;
+    if (!session->arriving) SendOutput(session, alive);
+    session->strand = strands[player.area].get();
+}
+
+void Simulation::Muster(const std::shared_ptr<Session>& session, const AreaID area)
+{
+    // Fights only start and end in the area the player's in, as getting away ends them
+    Battle& battle = *battles[area];
+    const bool fighting = session->player->foe.has_value();
+    if (fighting == session->fighting) return;
+    session->fighting = fighting;
+
+    if (!fighting)
+    {
+        // Kept in order, so each fight still gets its turn
+        const auto it = std::find(battle.fighters.begin(), battle.fighters.end(), session);
+        if (it - battle.fighters.begin() < (ptrdiff_t) battle.next) battle.next--;
+        battle.fighters.erase(it);
+        return;
+    }
+
+    battle.fighters.push_back(session);
+    if (!battle.ticking)
+    {
+        battle.ticking = true;
+        Schedule(combatTick, *strands[area], [this, area]() { Tick(area); });
+    }
+}
+
+void Simulation::Tick(const AreaID area)
+{
+    // However many are fighting, a tick only takes on so many of them, and the
+    // rest get theirs on the next, so everybody else in the area waits on it for
+    // no longer than that (and areas that never fight never tick)
+    Battle& battle = *battles[area];
+    for (size_t n = std::min(combatExchanges, battle.fighters.size()); n > 0; --n)
+    {
+        if (battle.next >= battle.fighters.size()) battle.next = 0;
+        const std::shared_ptr<Session> session = battle.fighters[battle.next];
+
+        const bool alive = Game::Get().OnExchange(*session->player);
+        if (session->player->foe.has_value()) battle.next++;
+        else
+        {
+            session->fighting = false;
+            battle.fighters.erase(battle.fighters.begin() + battle.next);
+        }
+
+        SendEvent(session, alive);
+    }
+
+    if (battle.fighters.empty()) battle.ticking = false;
+    else Schedule(combatTick, *strands[area], [this, area]() { Tick(area); });
+}
+
+void Simulation::SendOutput(const std::shared_ptr<Session>& session, const bool alive)
+{
+    Player& player = *session->player;
+    player << "\n";
+    SendReply(session, alive ? Reply::Output : Reply::Farewell, player.output, false);
+}
+
+void Simulation::SendEvent(const std::shared_ptr<Session>& session, const bool alive)
+{
+    // Should the loop fall behind on taking these, there's no waiting on it; the
+    // output stays with the player, going out with whatever's next sent (but the
+    // end of them always goes, as there's room kept for a farewell)
+    if (alive && session->events.load(std::memory_order_acquire) >= MAX_EVENTS_IN_FLIGHT) return;
+    session->events++;
+
+    Player& player = *session->player;
+    player << "\n";
+    SendReply(session, alive ? Reply::Output : Reply::Farewell, player.output, true);
+}
+
+void Simulation::SendReply(const std::shared_ptr<Session>& session, const Reply::Type type, std::string&& text, const bool event)
+{
+    Reply reply;
+    reply.type = type;
+    reply.text = std::move(text);
+    reply.event = event;
+    Deliver(session, std::move(reply));
+}
+
+void Simulation::SendReply(const std::shared_ptr<Session>& session, const Reply::Type type, Output& output, const bool event)
+{
+    // Hand over the buffer (and anything shared it refers to) rather than copying it
+    Reply reply;
+    reply.type = type;
+    reply.text = output.Take(reply.splices);
+    reply.event = event;
+    Deliver(session, std::move(reply));
+}
+
+void Simulation::Deliver(const std::shared_ptr<Session>& session, Reply&& reply)
+{
+    // Connections never have more commands in flight than the ring holds
+    if (!session->replies.Push(std::move(reply)))
+    {
+        std::cerr << "Reply ring full, reply dropped" << std::endl;
+        return;
+    }
+
+    // Only queue the session with its loop if it isn't already waiting there
+    if (!session->queued.exchange(true))
+        session->loop.Notify(session);
+}
+
+void Simulation::Report(const int interval)
+{
+    uint64_t executed = 0;
+    uint64_t totalLatency = 0;
+    uint64_t maxLatency = 0;
+
+    for (auto& stats : latencies)
+    {
+        executed += stats->executed.exchange(0, std::memory_order_relaxed);
+        totalLatency += stats->total.exchange(0, std::memory_order_relaxed);
+        maxLatency = std::max(maxLatency, stats->max.exchange(0, std::memory_order_relaxed));
+    }
+
+    std::cout << "Players: " << connected << " connected, " << waiting << " awaiting reconnection, "
+        << hibernated << " hibernated" << std::endl;
+
+    if (executed > 0)
+    {
+        std::cout << "Simulation ran " << executed << " command(s); latency mean "
+            << totalLatency / executed / 1000 << "us, max " << maxLatency / 1000 << "us" << std::endl;
+
+        const auto counters = WorkerPool::Get().TakeCounters();
+        for (size_t i = 0; i < counters.size(); ++i)
+        {
+            std::cout << "- Worker " << i << " ran " << counters[i].executed << " task(s), stole "
+                << counters[i].stolen << " and parked " << counters[i].parked << " time(s)" << std::endl;
+        }
+    }
+
+    timers.Schedule(interval * 1000, [this, interval]() { Report(interval); });
+}
+
+Simulation::~Simulation()
+{
+    // Runs for as long as the process does
+    if (thread.joinable()) thread.detach();
+
+    close(wakeFd);
+}
@@ -0,0 +1,30 @@
+#include "Strand.h"
+#include "WorkerPool.h"
+
+void Strand::Post(Task task)
+{
+    tasks.Push(std::move(task));
+
+    // Only the first to find the strand idle needs to hand it to a worker
+    if (!scheduled.exchange(true)) WorkerPool::Get().Submit([this]() { Run(); });
+}
+
+void Strand::Run()
+{
+    Task task;
+    for (int i = 0; i < STRAND_BATCH && tasks.Pop(task); ++i)
+        task();
+
+    // Go to the back of the line rather than hog the worker
+    if (!tasks.Empty())
+    {
+        WorkerPool::Get().Defer([this]() { Run(); });
+        return;
+    }
+
+    // Anything posted whilst we were letting go was posted by somebody who
+    // saw us still scheduled, so it's up to us to pick it up
+    scheduled = false;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!tasks.Empty() && !scheduled.exchange(true)) WorkerPool::Get().Submit([this]() { Run(); });
+}
@@ -0,0 +1,59 @@
+#include "Telnet.h"
+
+size_t Telnet::Parse(const char* data, const size_t size, std::optional<Negotiation>& negotiation)
+{
+    negotiation.reset();
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        const unsigned char byte = data[i];
+
+        switch (state)
+        {
+            case State::Data:
+                if (byte == IAC) state = State::Iac;
+                else return i;
+            break;
+
+            case State::Iac:
+                if (byte >= WILL && byte <= DONT)
+                {
+                    pending = (Command) byte;
+                    state = State::Negotiate;
+                }
+                else if (byte == SB) state = State::Subnegotiation;
+                else
+                {
+                    // Two-byte commands (and escaped 255s) mean nothing to a MUD
+                    state = State::Data;
+                    return i + 1;
+                }
+            break;
+
+            case State::Negotiate:
+                negotiation = Negotiation { pending, byte };
+                state = State::Data;
+            return i + 1;
+
+            case State::Subnegotiation:
+                if (byte == IAC) state = State::SubnegotiationIac;
+            break;
+
+            case State::SubnegotiationIac:
+                if (byte == SE)
+                {
+                    state = State::Data;
+                    return i + 1;
+                }
+                state = State::Subnegotiation;
+            break;
+        }
+    }
+
+    return size;
+}
+
+std::string Telnet::MakeCommand(const Command command, const unsigned char option)
+{
+    return std::string { (char) IAC, (char) command, (char) option };
+}
@@ -0,0 +1,173 @@
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(const unsigned int tickMs) :
+    tickMs(std::max(tickMs, 1u)), start(std::chrono::steady_clock::now()), currentTick(0), count(0)
+{
+    std::fill(std::begin(slots), std::end(slots), -1);
+}
+
+uint64_t TimerWheel::Now() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+TimerID TimerWheel::Schedule(const uint64_t delayMs, Callback callback)
+{
+    // Reuse an old timer where possible
+    int32_t index;
+    if (!freeTimers.empty())
+    {
+        index = freeTimers.back();
+        freeTimers.pop_back();
+    }
+    else
+    {
+        index = timers.size();
+        timers.emplace_back();
+        // Starting at 1 means an ID of 0 never matches, so it can stand for "no timer"
+        timers.back().generation = 1;
+    }
+
+    // Round up, so a timer never fires early, and never fire in the past
+    auto& timer = timers[index];
+    timer.callback = std::move(callback);
+    timer.expiry = std::max((Now() + delayMs + tickMs - 1) / tickMs, currentTick + 1);
+    timer.slot = -1;
+
+    Insert(index);
+    count++;
+    return (TimerID) timer.generation << 32 | (uint32_t) index;
+}
+
+void TimerWheel::Cancel(const TimerID id)
+{
+    const int32_t index = (int32_t)(id & 0xFFFFFFFF);
+    if (index < 0 || (size_t) index >= timers.size()) return;
+
+    // Already fired, cancelled or reused
+    auto& timer = timers[index];
+    if (timer.generation != (uint32_t)(id >> 32) || !timer.callback) return;
+
+    Unlink(index);
+    Release(index);
+}
+
+void TimerWheel::Insert(const int32_t index)
+{
+    auto& timer = timers[index];
+
+    // Pick the lowest level whose slots will come back around before the timer's due
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           (timer.expiry >> (level * TIMER_WHEEL_BITS)) - (currentTick >> (level * TIMER_WHEEL_BITS)) >= TIMER_WHEEL_SLOTS)
+        level++;
+
+    // Anything further off than the wheel reaches just waits at the far end
+    const int shift = level * TIMER_WHEEL_BITS;
+    if ((timer.expiry >> shift) - (currentTick >> shift) >= TIMER_WHEEL_SLOTS)
+        timer.expiry = ((currentTick >> shift) + TIMER_WHEEL_SLOTS - 1) << shift;
+
+    const int32_t slot = level * TIMER_WHEEL_SLOTS + ((timer.expiry >> shift) & (TIMER_WHEEL_SLOTS - 1));
+
+    // Push onto the front of the slot's list
+    timer.slot = slot;
+    timer.previous = -1;
+    timer.next = slots[slot];
+    if (timer.next != -1) timers[timer.next].previous = index;
+    slots[slot] = index;
+}
+
+void TimerWheel::Unlink(const int32_t index)
+{
+    auto& timer = timers[index];
+    if (timer.slot == -1) return;
+
+    if (timer.previous != -1) timers[timer.previous].next = timer.next;
+    else slots[timer.slot] = timer.next;
+
+    if (timer.next != -1) timers[timer.next].previous = timer.previous;
+    timer.slot = -1;
+}
+
+void TimerWheel::Release(const int32_t index)
+{
+    auto& timer = timers[index];
+    timer.callback = nullptr;
+    timer.generation++;
+    freeTimers.emplace_back(index);
+    count--;
+}
+
+void TimerWheel::Cascade(const int level)
+{
+    // Move everything in the current slot down towards level 0
+    const int32_t slot = level * TIMER_WHEEL_SLOTS + ((currentTick >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1));
+    int32_t index = slots[slot];
+    slots[slot] = -1;
+
+    while (index != -1)
+    {
+        const int32_t next = timers[index].next;
+        timers[index].slot = -1;
+        Insert(index);
+        index = next;
+    }
+}
+
+void TimerWheel::Advance()
+{
+    const uint64_t target = Now() / tickMs;
+    std::vector<std::pair<int32_t, uint32_t>> due;
+
+    while (currentTick < target)
+    {
+        currentTick++;
+
+        // Higher levels are cascaded as the level below wraps back around
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; ++level)
+        {
+            if ((currentTick & ((1ull << (level * TIMER_WHEEL_BITS)) - 1)) != 0) break;
+            Cascade(level);
+        }
+
+        // Detach the whole slot first, as callbacks are free to schedule and cancel
+        const int32_t slot = currentTick & (TIMER_WHEEL_SLOTS - 1);
+        for (int32_t index = slots[slot]; index != -1; index = timers[index].next)
+        {
+            due.emplace_back(index, timers[index].generation);
+            timers[index].slot = -1;
+        }
+        slots[slot] = -1;
+
+        for (const auto& [index, generation] : due)
+        {
+            // Cancelled by an earlier callback
+            if (timers[index].generation != generation) continue;
+
+            Callback callback = std::move(timers[index].callback);
+            Release(index);
+            callback();
+        }
+
+        due.clear();
+    }
+}
+
+int TimerWheel::GetTimeout() const
+{
+    if (count == 0) return -1;
+
+    // Look for the next busy slot on level 0, or else wake up for the next cascade
+    uint64_t ticks = TIMER_WHEEL_SLOTS - (currentTick & (TIMER_WHEEL_SLOTS - 1));
+    for (uint64_t i = 1; i < ticks; ++i)
+    {
+        if (slots[(currentTick + i) & (TIMER_WHEEL_SLOTS - 1)] != -1)
+        {
+            ticks = i;
+            break;
+        }
+    }
+
+    const int64_t wait = (int64_t)((currentTick + ticks) * tickMs) - (int64_t) Now();
+    return (int) std::max(wait, (int64_t) 0);
+}
@@ -0,0 +1,71 @@
+#include "Tokenizer.h"
+
+#include <charconv>
+
+static bool IsSpace(const char c) { return c == ' ' || c == '\t'; }
+
+// True only if the whole of the text is digits, and they fit
+static bool ParseInt(const std::string_view text, int& number)
+{
+    if (text.empty() || !std::all_of(text.begin(), text.end(), ::isdigit)) return false;
+    return std::from_chars(text.data(), text.data() + text.size(), number).ec == std::errc();
+}
+
+Tokenizer::Tokenizer(std::string_view line) : count(0), valid(true)
+{
+    size_t i = 0;
+    const auto SkipSpaces = [&]() { while (i < line.size() && IsSpace(line[i])) i++; };
+
+    SkipSpaces();
+    const size_t verbStart = i;
+    while (i < line.size() && !IsSpace(line[i])) i++;
+    verb = line.substr(verbStart, i - verbStart);
+
+    for (SkipSpaces(); i < line.size(); SkipSpaces())
+    {
+        if (count == MAX_ARGUMENTS)
+        {
+            valid = false;
+            return;
+        }
+
+        Token& token = arguments[count++];
+
+        // Quoted text runs to the closing quote, whatever's in between
+        if (line[i] == '"')
+        {
+            const size_t end = line.find('"', i + 1);
+            if (end == std::string_view::npos)
+            {
+                valid = false;
+                return;
+            }
+
+            token.type = Token::Text;
+            token.text = line.substr(i + 1, end - i - 1);
+            i = end + 1;
+            continue;
+        }
+
+        const size_t start = i;
+        while (i < line.size() && !IsSpace(line[i])) i++;
+        token.text = line.substr(start, i - start);
+
+        if (ParseInt(token.text, token.number)) token.type = Token::Number;
+        else if ((token.text[0] == 'x' || token.text[0] == 'X') && ParseInt(token.text.substr(1), token.number)) token.type = Token::Count;
+        else token.type = Token::Word;
+    }
+}
+
+std::optional<std::string_view> Tokenizer::GetText(const size_t i) const
+{
+    // Any token will do as text, so a one-word name needn't be quoted
+    if (i >= count) return {};
+    return arguments[i].text;
+}
+
+std::optional<int> Tokenizer::GetInt(const size_t i, const Token::Type type) const
+{
+    if (i >= count || arguments[i].type != type) return {};
+    return arguments[i].number;
+}
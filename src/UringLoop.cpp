@@ -0,0 +1,580 @@
+#include "UringLoop.h"
+
+#ifdef SLUDGE_IO_URING
+
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+
+#define RING_ENTRIES 256
+#define BUFFER_COUNT 1024 // Must be a power of two
+#define BUFFER_GROUP 0
+
+UringLoop::UringLoop(int serverFd) : EventLoop(serverFd),
+    ringFd(-1), submissionRing(MAP_FAILED), submissionEntries((io_uring_sqe*)MAP_FAILED),
+    localTail(0), pending(0), bufferRing((io_uring_buf_ring*)MAP_FAILED), buffers(nullptr), useBufferRing(false),
+    accepting(false), stopping(false), waking(false) {}
+
+bool UringLoop::Initialise()
+{
+    // Multishot receives (and so all of the below) arrived in Linux 6.0; older kernels
+    // would accept the ring but then fail every operation we care about
+    utsname name;
+    int major = 0, minor = 0;
+    if (uname(&name) < 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2 || major < 6)
+    {
+        std::cerr << "io_uring backend needs Linux 6.0 or later" << std::endl;
+        return false;
+    }
+
+    // Ask for a roomier completion queue, since every client can have a receive and
+    // a send complete at once; the remaining flags are only hints, so try without them too
+    io_uring_params params = {};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+    params.cq_entries = RING_ENTRIES * 4;
+    ringFd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+
+    if (ringFd < 0 && errno == EINVAL)
+    {
+        params = {};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = RING_ENTRIES * 4;
+        ringFd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    }
+
+    if (ringFd < 0)
+    {
+        perror("Unable to create io_uring");
+        return false;
+    }
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_EXT_ARG))
+    {
+        std::cerr << "io_uring lacks required features" << std::endl;
+        return false;
+    }
+
+    // Both queues live in the one mapping
+    submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    submissionRingSize = std::max(submissionRingSize, completionRingSize);
+
+    submissionRing = mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (submissionRing == MAP_FAILED)
+    {
+        perror("Unable to map io_uring queues");
+        return false;
+    }
+
+    submissionEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    submissionEntries = (io_uring_sqe*) mmap(nullptr, submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (submissionEntries == MAP_FAILED)
+    {
+        perror("Unable to map io_uring submissions");
+        return false;
+    }
+
+    char* ring = (char*) submissionRing;
+    submissionHead = (unsigned*)(ring + params.sq_off.head);
+    submissionTail = (unsigned*)(ring + params.sq_off.tail);
+    submissionMask = *(unsigned*)(ring + params.sq_off.ring_mask);
+    submissionArray = (unsigned*)(ring + params.sq_off.array);
+    localTail = *submissionTail;
+
+    completionRing = submissionRing;
+    completionHead = (unsigned*)(ring + params.cq_off.head);
+    completionTail = (unsigned*)(ring + params.cq_off.tail);
+    completionMask = *(unsigned*)(ring + params.cq_off.ring_mask);
+    completionEntries = (io_uring_cqe*)(ring + params.cq_off.cqes);
+
+    // Hand the kernel a ring of buffers to receive into, so that idle clients
+    // don't each need a buffer of their own sitting around waiting for data
+    bufferRingSize = BUFFER_COUNT * sizeof(io_uring_buf);
+    bufferRing = (io_uring_buf_ring*) mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (bufferRing == MAP_FAILED)
+    {
+        perror("Unable to allocate io_uring buffer ring");
+        return false;
+    }
+
+    io_uring_buf_reg registration = {};
+    registration.ring_addr = (uint64_t) bufferRing;
+    registration.ring_entries = BUFFER_COUNT;
+    registration.bgid = BUFFER_GROUP;
+
+    buffers = new char[BUFFER_COUNT * BUFFER_SIZE];
+    useBufferRing = syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) == 0;
+
+    for (unsigned short i = 0; i < BUFFER_COUNT; ++i)
+        ProvideBuffer(i);
+
+    // Some kernels accept the ring yet never hand its buffers out, so try it for real
+    // and, failing that, fall back to providing buffers one operation at a time
+    if (useBufferRing && !ProbeBufferRing())
+    {
+        std::cerr << "io_uring buffer ring unusable, providing buffers individually" << std::endl;
+        syscall(__NR_io_uring_register, ringFd, IORING_UNREGISTER_PBUF_RING, &registration, 1);
+
+        useBufferRing = false;
+        for (unsigned short i = 0; i < BUFFER_COUNT; ++i)
+            ProvideBuffer(i);
+    }
+
+    return true;
+}
+
+bool UringLoop::ProbeBufferRing()
+{
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) return false;
+    send(pair[1], "?", 1, MSG_NOSIGNAL);
+
+    io_uring_sqe* submission = GetSubmission();
+    submission->opcode = IORING_OP_RECV;
+    submission->fd = pair[0];
+    submission->flags = IOSQE_BUFFER_SELECT;
+    submission->buf_group = BUFFER_GROUP;
+    submission->user_data = Operation::Probe << 32;
+
+    bool success = false;
+    if (Submit(1) >= 0)
+    {
+        const unsigned head = *completionHead;
+        const io_uring_cqe completion = completionEntries[head & completionMask];
+        __atomic_store_n(completionHead, head + 1, __ATOMIC_RELEASE);
+
+        success = completion.res == 1 && (completion.flags & IORING_CQE_F_BUFFER);
+        if (success) ProvideBuffer(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+    }
+
+    close(pair[0]);
+    close(pair[1]);
+    return success;
+}
+
+void UringLoop::Run()
+{
+    ArmAccept();
+    ArmStop();
+    if (!waking) ArmWake();
+    int timeout = RunTimers();
+
+    // Pick up any clients adopted (or left over from an earlier run)
+    DeliverReplies();
+    for (auto& [fd, client] : clients)
+    {
+        UpdateReceive(fd);
+        dirty.emplace_back(fd);
+    }
+
+    while (!stopping || !IsIdle())
+    {
+        // Everything queued whilst handling the last batch goes out in one go
+        if (!stopping) QueueSends();
+
+        // Wait for a completion, or for the next timer, whichever comes first
+        if (Submit(1, timeout) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN && errno != ETIME)
+        {
+            perror("Unable to submit to io_uring");
+            return;
+        }
+
+        unsigned head = *completionHead;
+        while (head != __atomic_load_n(completionTail, __ATOMIC_ACQUIRE))
+        {
+            // Copy out and free the slot straight away, as handling a completion
+            // may well queue up more work of its own
+            const io_uring_cqe completion = completionEntries[head & completionMask];
+            __atomic_store_n(completionHead, ++head, __ATOMIC_RELEASE);
+
+            OnCompletion(completion);
+        }
+
+        timeout = RunTimers();
+    }
+
+    stopping = false;
+}
+
+bool UringLoop::IsIdle() const
+{
+    if (accepting) return false;
+
+    for (const auto& [fd, client] : clients)
+        if (client.receiving || client.sending) return false;
+
+    return true;
+}
+
+std::vector<Connection::Snapshot> UringLoop::Save()
+{
+    // Input held back whilst paused goes along too
+    auto snapshots = EventLoop::Save();
+    for (auto& snapshot : snapshots)
+        snapshot.unread = clients[snapshot.fd].stash;
+
+    return snapshots;
+}
+
+void UringLoop::Adopt(const Connection::Snapshot& snapshot)
+{
+    // Requests on a non-blocking socket could fail rather than wait
+    fcntl(snapshot.fd, F_SETFL, fcntl(snapshot.fd, F_GETFL, 0) & ~O_NONBLOCK);
+
+    AddConnection(snapshot);
+    clients[snapshot.fd] = {};
+    clients[snapshot.fd].stash = snapshot.unread;
+}
+
+io_uring_sqe* UringLoop::GetSubmission()
+{
+    // Flush to the kernel if the queue is full
+    if (localTail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE) > submissionMask)
+        Submit(0);
+
+    const unsigned index = localTail & submissionMask;
+    io_uring_sqe* submission = &submissionEntries[index];
+    memset(submission, 0, sizeof(*submission));
+
+    submissionArray[index] = index;
+    localTail++;
+    pending++;
+    return submission;
+}
+
+int UringLoop::Submit(const unsigned waitFor, const int timeout)
+{
+    __atomic_store_n(submissionTail, localTail, __ATOMIC_RELEASE);
+
+    int submitted;
+    if (waitFor && timeout >= 0)
+    {
+        // Passing the timeout along with the wait saves a timeout request per iteration
+        __kernel_timespec time = { timeout / 1000, (timeout % 1000) * 1000000ll };
+        io_uring_getevents_arg argument = {};
+        argument.ts = (uint64_t) &time;
+
+        submitted = syscall(__NR_io_uring_enter, ringFd, pending, waitFor, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument, sizeof(argument));
+    }
+    else submitted = syscall(__NR_io_uring_enter, ringFd, pending, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+    if (submitted > 0) pending -= std::min((unsigned) submitted, pending);
+    return submitted;
+}
+
+void UringLoop::ProvideBuffer(const unsigned short id)
+{
+    if (!useBufferRing)
+    {
+        io_uring_sqe* submission = GetSubmission();
+        submission->opcode = IORING_OP_PROVIDE_BUFFERS;
+        submission->fd = 1;
+        submission->addr = (uint64_t)(buffers + id * BUFFER_SIZE);
+        submission->len = BUFFER_SIZE;
+        submission->buf_group = BUFFER_GROUP;
+        submission->off = id;
+        submission->user_data = Operation::Provide << 32;
+        return;
+    }
+
+    // We're the only ones adding buffers, so the tail is ours to bump
+    const unsigned short tail = bufferRing->tail;
+    io_uring_buf& buffer = bufferRing->bufs[tail & (BUFFER_COUNT - 1)];
+    buffer.addr = (uint64_t)(buffers + id * BUFFER_SIZE);
+    buffer.len = BUFFER_SIZE;
+    buffer.bid = id;
+
+    __atomic_store_n(&bufferRing->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
+
+void UringLoop::ArmStop()
+{
+    io_uring_sqe* submission = GetSubmission();
+    submission->opcode = IORING_OP_POLL_ADD;
+    submission->fd = GetStopFd();
+    submission->poll32_events = POLLIN;
+    submission->user_data = Operation::Stop << 32;
+}
+
+void UringLoop::ArmWake()
+{
+    // Stays armed across runs, as there's nothing to wait on it for
+    io_uring_sqe* submission = GetSubmission();
+    submission->opcode = IORING_OP_POLL_ADD;
+    submission->fd = wakeFd;
+    submission->poll32_events = POLLIN;
+    submission->len = IORING_POLL_ADD_MULTI;
+    submission->user_data = Operation::Wake << 32;
+
+    waking = true;
+}
+
+void UringLoop::OnStop()
+{
+    // Cut short everything that could otherwise wait on a client indefinitely
+    stopping = true;
+    if (accepting) CancelRequest(Operation::Accept << 32, 0);
+
+    for (auto& [fd, client] : clients)
+    {
+        if (client.receiving && !client.cancelling)
+        {
+            CancelRequest(Operation::Receive << 32 | (uint32_t) fd, fd);
+            client.cancelling = true;
+        }
+
+        if (client.sending) CancelRequest(Operation::Send << 32 | (uint32_t) fd, fd);
+    }
+}
+
+void UringLoop::CancelRequest(const uint64_t userData, const int fd)
+{
+    io_uring_sqe* submission = GetSubmission();
+    submission->opcode = IORING_OP_ASYNC_CANCEL;
+    submission->addr = userData;
+    submission->user_data = Operation::Cancel << 32 | (uint32_t) fd;
+}
+
+void UringLoop::ArmAccept()
+{
+    accepting = true;
+
+    io_uring_sqe* submission = GetSubmission();
+    submission->opcode = IORING_OP_ACCEPT;
+    submission->fd = serverFd;
+    submission->ioprio = IORING_ACCEPT_MULTISHOT;
+    submission->accept_flags = SOCK_CLOEXEC;
+    submission->user_data = Operation::Accept << 32;
+}
+
+void UringLoop::ArmReceive(const int fd)
+{
+    io_uring_sqe* submission = GetSubmission();
+    submission->opcode = IORING_OP_RECV;
+    submission->fd = fd;
+    submission->ioprio = IORING_RECV_MULTISHOT;
+    submission->flags = IOSQE_BUFFER_SELECT;
+    submission->buf_group = BUFFER_GROUP;
+    submission->user_data = Operation::Receive << 32 | (uint32_t) fd;
+
+    clients[fd].receiving = true;
+}
+
+void UringLoop::QueueSends()
+{
+    for (const int fd : dirty)
+    {
+        const auto it = connections.find(fd);
+        if (it == connections.end()) continue;
+
+        // Closed by a timer rather than by anything the kernel told us
+        auto& connection = *it->second;
+        if (connection.IsClosed())
+        {
+            Retire(fd);
+            continue;
+        }
+
+        auto& client = clients[fd];
+        if (client.sending || client.shutdown || !connection.HasOutput()) continue;
+
+        // Both the output and the message describing it stay put until
+        // the completion tells us how much went
+        client.message = {};
+        client.message.msg_iov = client.vectors;
+        client.message.msg_iovlen = connection.GatherOutput(client.vectors, MAX_OUTPUT_VECTORS, true);
+
+        io_uring_sqe* submission = GetSubmission();
+        submission->opcode = IORING_OP_SENDMSG;
+        submission->fd = fd;
+        submission->addr = (uint64_t) &client.message;
+        submission->len = 1;
+        submission->msg_flags = MSG_NOSIGNAL;
+        submission->user_data = Operation::Send << 32 | (uint32_t) fd;
+
+        client.sending = true;
+    }
+
+    dirty.clear();
+}
+
+void UringLoop::OnCompletion(const io_uring_cqe& completion)
+{
+    const auto operation = completion.user_data >> 32;
+    const int fd = (int)(completion.user_data & 0xFFFFFFFF);
+
+    switch (operation)
+    {
+        case Operation::Accept:
+            OnAccept(completion);
+        break;
+
+        case Operation::Receive:
+            OnReceive(fd, completion);
+        break;
+
+        case Operation::Send:
+            OnSend(fd, completion);
+        break;
+
+        case Operation::Cancel:
+        break;
+
+        case Operation::Stop:
+            OnStop();
+        break;
+
+        case Operation::Wake:
+            if (!(completion.flags & IORING_CQE_F_MORE)) ArmWake();
+            DeliverReplies();
+        break;
+
+        case Operation::Provide:
+            if (completion.res < 0) std::cerr << "Unable to provide io_uring buffer" << std::endl;
+        break;
+
+        default:
+        break;
+    }
+}
+
+void UringLoop::OnAccept(const io_uring_cqe& completion)
+{
+    // The kernel may stop a multishot request at any time (e.g. on error), so re-arm
+    if (!(completion.flags & IORING_CQE_F_MORE))
+    {
+        accepting = false;
+        if (!stopping) ArmAccept();
+    }
+
+    if (completion.res == -ECANCELED) return;
+    if (completion.res < 0)
+    {
+        errno = -completion.res;
+        perror("Unable to accept client connection");
+        return;
+    }
+
+    const int clientFd = completion.res;
+    AddConnection(clientFd);
+    clients[clientFd] = {};
+
+    if (!stopping) ArmReceive(clientFd);
+    dirty.emplace_back(clientFd);
+}
+
+void UringLoop::OnReceive(const int fd, const io_uring_cqe& completion)
+{
+    auto& client = clients[fd];
+    auto& connection = *connections.at(fd);
+
+    if (!(completion.flags & IORING_CQE_F_MORE))
+    {
+        client.receiving = false;
+        client.cancelling = false;
+    }
+
+    if (completion.flags & IORING_CQE_F_BUFFER)
+    {
+        // Input that arrives after pausing (but before the cancel lands) can't be
+        // taken yet, so hold onto it, along with anything after it, until it can
+        const unsigned short id = completion.flags >> IORING_CQE_BUFFER_SHIFT;
+        const char* data = buffers + id * BUFFER_SIZE;
+
+        if (completion.res > 0 && client.stash.empty())
+        {
+            const size_t taken = connection.OnReceive(data, completion.res);
+            client.stash.append(data + taken, completion.res - taken);
+        }
+        else if (completion.res > 0) client.stash.append(data, completion.res);
+
+        ProvideBuffer(id);
+    }
+
+    // Running out of buffers or being cancelled only pauses the receive; anything else means the end
+    if (completion.res == 0 || (completion.res < 0 && completion.res != -ENOBUFS && completion.res != -ECANCELED))
+        connection.OnHangup();
+
+    if (connection.HasOutput()) dirty.emplace_back(fd);
+    UpdateReceive(fd);
+    if (connection.IsClosed()) Retire(fd);
+}
+
+void UringLoop::UpdateReceive(const int fd)
+{
+    auto& client = clients[fd];
+    auto& connection = *connections.at(fd);
+
+    if (!client.stash.empty() && connection.WantsInput())
+    {
+        client.stash.erase(0, connection.OnReceive(client.stash.data(), client.stash.size()));
+        if (connection.HasOutput()) dirty.emplace_back(fd);
+    }
+
+    if (!client.receiving && connection.WantsInput() && !stopping) ArmReceive(fd);
+
+    // Whilst output's backed up, stop receiving altogether and leave any further
+    // input in the kernel, so that TCP pushes back on the client for us
+    else if (client.receiving && !client.cancelling && (!connection.WantsInput() || stopping) && !client.shutdown)
+    {
+        CancelRequest(Operation::Receive << 32 | (uint32_t) fd, fd);
+        client.cancelling = true;
+    }
+}
+
+void UringLoop::OnSend(const int fd, const io_uring_cqe& completion)
+{
+    auto& connection = *connections.at(fd);
+    clients[fd].sending = false;
+
+    // Only cancelled when stopping, in which case it's sent again after the restart
+    if (completion.res == -ECANCELED) return;
+    if (completion.res < 0) connection.OnHangup();
+    else connection.OnSent(completion.res);
+
+    if (connection.HasOutput()) dirty.emplace_back(fd);
+    if (!connection.IsClosed()) UpdateReceive(fd);
+    if (connection.IsClosed()) Retire(fd);
+}
+
+void UringLoop::OnUnblocked(Connection& connection)
+{
+    UpdateReceive(connection.fd);
+}
+
+void UringLoop::Retire(const int fd)
+{
+    auto& client = clients[fd];
+
+    // Knock any requests still in flight loose; their completions bring us back here
+    if (!client.shutdown)
+    {
+        shutdown(fd, SHUT_RDWR);
+        client.shutdown = true;
+    }
+
+    // Only once the kernel's done with the socket is it safe to close (and reuse) the fd
+    if (client.receiving || client.sending) return;
+
+    clients.erase(fd);
+    connections.erase(fd);
+}
+
+UringLoop::~UringLoop()
+{
+    connections.clear();
+
+    if (bufferRing != MAP_FAILED) munmap(bufferRing, bufferRingSize);
+    if (submissionEntries != MAP_FAILED) munmap(submissionEntries, submissionEntriesSize);
+    if (submissionRing != MAP_FAILED) munmap(submissionRing, submissionRingSize);
+    if (ringFd >= 0) close(ringFd);
+
+    delete[] buffers;
+}
+
+#endif
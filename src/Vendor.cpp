@@ -44,22 +44,26 @@ Vendor::Vendor(const Type type)
     }
 }
 
-void Vendor::AddItem(ItemID itemID)
+void Vendor::AddItem(ItemID itemID, unsigned int number)
 {
+    table.Invalidate();
+
     for (auto& stack : items)
     {
         if (stack.item == itemID)
         {
-            stack.number++;
+            stack.number += number;
             return;
         }
     }
 
-    items.emplace_back(itemID, 1);
+    items.emplace_back(itemID, number);
 }
 
 void Vendor::RemoveItem(size_t vectorIndex)
 {
+    table.Invalidate();
+
     // Remove 1 from stack, or remove item entirely
     if (items[vectorIndex].number > 1) items[vectorIndex].number--;
     else items.erase(items.begin() + vectorIndex);
@@ -0,0 +1,241 @@
+#include "WorkerPool.h"
+#include "Config.h"
+
+// How long (in microseconds) an idle worker keeps looking for work before parking
+#define WORKER_SPIN_US 50
+
+static thread_local int workerIndex = -1;
+
+WorkerPool::WorkerPool() :
+    sharedSize(0), outstanding(0), running(0), sleepers(0), pausing(false), paused(false)
+{
+    int count = Config::Get().GetInt("worker_threads", 0);
+    if (count <= 0) count = std::max(std::thread::hardware_concurrency(), 1u);
+    // On a single core, spinning only holds up whoever's about to hand us work
+    const int spinUs = std::thread::hardware_concurrency() > 1 ? WORKER_SPIN_US : 0;
+    spin = std::chrono::microseconds(Config::Get().GetInt("worker_spin_us", spinUs));
+
+    // Workers go looking through each other's deques, so all are made before any start
+    for (int i = 0; i < count; ++i)
+        workers.emplace_back(std::make_unique<Worker>());
+
+    for (int i = 0; i < count; ++i)
+        workers[i]->thread = std::thread([this, i]() { Work(i); });
+}
+
+void WorkerPool::Submit(Task task)
+{
+    Push(new Task(std::move(task)), false);
+}
+
+void WorkerPool::Defer(Task task)
+{
+    Push(new Task(std::move(task)), true);
+}
+
+void WorkerPool::Push(Task* task, const bool deferred)
+{
+    outstanding++;
+
+    if (!deferred && workerIndex >= 0) workers[workerIndex]->tasks.Push(task);
+    else
+    {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        shared.push_back(task);
+        sharedSize++;
+    }
+
+    WakeOne();
+}
+
+void WorkerPool::WakeOne()
+{
+    // Workers count themselves as asleep before their last look for work, so
+    // either they see what's just been pushed or we see them
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers == 0) return;
+
+    std::lock_guard<std::mutex> lock(parkMutex);
+    parkChanged.notify_one();
+}
+
+void WorkerPool::Run(std::vector<Task> tasks)
+{
+    size_t remaining = tasks.size();
+    std::mutex mutex;
+    std::condition_variable done;
+
+    for (auto& task : tasks)
+    {
+        Submit([&, task = std::move(task)]()
+        {
+            task();
+
+            // Counted down under the lock, or we might see the last task finish and
+            // return (taking the lock and condition with us) before it's let go of them
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0) done.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return remaining == 0; });
+}
+
+void WorkerPool::Pause()
+{
+    std::unique_lock<std::mutex> lock(parkMutex);
+
+    // Let everything run dry first...
+    pausing = true;
+    idle.wait(lock, [this]() { return outstanding == 0; });
+
+    // ...then wait on anybody who got hold of something since
+    paused = true;
+    idle.wait(lock, [this]() { return running == 0; });
+    pausing = false;
+}
+
+void WorkerPool::Resume()
+{
+    {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        paused = false;
+    }
+
+    parkChanged.notify_all();
+}
+
+int WorkerPool::GetWorkerIndex()
+{
+    return workerIndex;
+}
+
+std::vector<WorkerPool::Counters> WorkerPool::TakeCounters()
+{
+    std::vector<Counters> counters;
+    for (auto& worker : workers)
+    {
+        counters.push_back
+        ({
+            worker->executed.exchange(0, std::memory_order_relaxed),
+            worker->stolen.exchange(0, std::memory_order_relaxed),
+            worker->parked.exchange(0, std::memory_order_relaxed)
+        });
+    }
+
+    return counters;
+}
+
+void WorkerPool::Work(const size_t index)
+{
+    workerIndex = index;
+    Worker& worker = *workers[index];
+
+    while (1)
+    {
+        // Counted as running before checking for a pause, so Pause() waits on us
+        running++;
+
+        Task* task = paused ? nullptr : Find(index);
+        if (task == nullptr && !paused)
+        {
+            const auto until = std::chrono::steady_clock::now() + spin;
+            while (task == nullptr && !paused && std::chrono::steady_clock::now() < until)
+            {
+                std::this_thread::yield();
+                task = Find(index);
+            }
+        }
+
+        if (task != nullptr)
+        {
+            (*task)();
+            delete task;
+            worker.executed.fetch_add(1, std::memory_order_relaxed);
+            Finished();
+        }
+
+        if (--running == 0 && paused)
+        {
+            std::lock_guard<std::mutex> lock(parkMutex);
+            idle.notify_all();
+        }
+
+        if (task != nullptr) continue;
+
+        // Nothing doing, so sleep until there is
+        std::unique_lock<std::mutex> lock(parkMutex);
+        sleepers++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (paused || !HasWork())
+        {
+            worker.parked.fetch_add(1, std::memory_order_relaxed);
+            parkChanged.wait(lock, [this]() { return !paused && HasWork(); });
+        }
+
+        sleepers--;
+    }
+}
+
+WorkerPool::Task* WorkerPool::Find(const size_t index)
+{
+    Worker& worker = *workers[index];
+
+    Task* task;
+    if (worker.tasks.Pop(task)) return task;
+
+    if (sharedSize > 0)
+    {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!shared.empty())
+        {
+            task = shared.front();
+            shared.pop_front();
+            sharedSize--;
+            return task;
+        }
+    }
+
+    // Start from somebody different each time, so nobody gets picked on
+    static thread_local size_t next = 0;
+    const size_t count = workers.size();
+    const size_t start = next++;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t victim = (index + 1 + start + i) % count;
+        if (victim != index && workers[victim]->tasks.Steal(task))
+        {
+            worker.stolen.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+bool WorkerPool::HasWork() const
+{
+    if (sharedSize > 0) return true;
+
+    for (const auto& worker : workers)
+        if (!worker->tasks.Empty()) return true;
+
+    return false;
+}
+
+void WorkerPool::Finished()
+{
+    if (--outstanding > 0 || !pausing) return;
+
+    std::lock_guard<std::mutex> lock(parkMutex);
+    idle.notify_all();
+}
+
+WorkerPool::~WorkerPool()
+{
+    // Runs for as long as the process does
+    for (auto& worker : workers)
+        if (worker->thread.joinable()) worker->thread.detach();
+}
@@ -4,6 +4,7 @@
 #include "Game.h"
 #include "Cave.h"
 #include "Town.h"
+#include "WorkerPool.h"
 
 World::World(const int width, const int height, const unsigned int seed) : Area(seed), width(width), height(height)
 {
@@ -96,17 +97,50 @@ void World::LoadAreas()
         return new Town(++townSeed, portal);
     });
 
-    // Generate paths
+    // Generate paths. Laying one only matters to the next if it turns water into
+    // something walkable, which only the centre can see (as a path may end in
+    // water, but never passes through it), so paths are laid one at a time until
+    // the centre's dry, after which the rest are worked out in parallel
     Cell centre = height / 2 * width + width / 2;
-    for (size_t i = 0; i < towns.size(); ++i)
-        CreatePath(towns[i], centre);
+    size_t laid = 0;
+    for (; laid < towns.size() && tiles[centre] == Tile::Water; ++laid)
+        for (const Cell cell : CreatePath(towns[laid], centre))
+            tiles[cell] = Tile::Path;
+
+    std::vector<std::vector<Cell>> paths(towns.size());
+    std::vector<WorkerPool::Task> tasks;
+    for (size_t i = laid; i < towns.size(); ++i)
+        tasks.emplace_back([this, &paths, &towns, centre, i]() { paths[i] = CreatePath(towns[i], centre); });
+
+    WorkerPool::Get().Run(std::move(tasks));
+
+    for (const auto& path : paths)
+        for (const Cell cell : path)
+            tiles[cell] = Tile::Path;
+
+    Bake();
+}
+
+void World::Bake()
+{
+    planeWidth = width + VIEW_RADIUS_X * 2;
+    plane.assign(planeWidth * (height + VIEW_RADIUS_Y * 2), TileToChar(Tile::None));
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const Cell cell = y * width + x;
+            plane[(y + VIEW_RADIUS_Y) * planeWidth + x + VIEW_RADIUS_X] = portals.count(cell) ? '?' : TileToChar(tiles[cell]);
+        }
+    }
 }
 
 /*
     Uses A* path-finding
     https://en.wikipedia.org/wiki/A*_search_algorithm
 */
-void World::CreatePath(const Cell startCell, const Cell endCell)
+std::vector<Cell> World::CreatePath(const Cell startCell, const Cell endCell) const
 {
     // Make nodes
     struct Node
@@ -205,15 +239,18 @@ void World::CreatePath(const Cell startCell, const Cell endCell)
     }
 
     // Walk from end node to start node, following parents and creating paths
+    std::vector<Cell> path;
     if (end != nullptr)
     {
         Node* n = end;
         while (n->parent != nullptr)
         {
-            tiles[n->y * width + n->x] = Tile::Path;
+            path.push_back(n->y * width + n->x);
             n = n->parent;
         }
     }
+
+    return path;
 }
 
 Cell World::GetStartingCell() const
@@ -233,54 +270,79 @@ void World::Look(Player& player) const
     if (portal.has_value())
         player << "- " << Game::Get().areas[portal->area]->GetPortalText() << "\n";
 
-    const int viewWidth = 10;
-    const int viewHeight = 5;
+    // A slice of each row of the baked map, with the player put in the middle
+    char view[VIEW_ROWS][VIEW_COLUMNS];
+    for (int row = 0; row < VIEW_ROWS; ++row)
+        memcpy(view[row], &plane[(worldY + row) * planeWidth + worldX], VIEW_COLUMNS);
+    view[VIEW_RADIUS_Y][VIEW_RADIUS_X] = 'X';
 
-    // Top and bottom borders
-    const auto DrawEdge = [&]()
+    if (player.pinnedMap)
     {
-        for (int i = 0; i < viewWidth+1; ++i) player << "#";
-        player << "\n";
-    };
+        DrawPinned(player, view);
+        return;
+    }
 
-    player << "\n";
-    DrawEdge();
+    // Bordered all round, and sent in one go
+    const size_t lineLength = VIEW_COLUMNS + 3;
+    char map[1 + lineLength * (VIEW_ROWS + 2)];
+    char* line = map;
+    *line++ = '\n';
+
+    memset(line, '#', lineLength - 1);
+    line[lineLength - 1] = '\n';
+    line += lineLength;
 
-    for (int viewY = -viewHeight/2+1; viewY < viewHeight/2; ++viewY)
+    for (int row = 0; row < VIEW_ROWS; ++row)
     {
-        player << "#";
+        line[0] = '#';
+        memcpy(line + 1, view[row], VIEW_COLUMNS);
+        line[lineLength - 2] = '#';
+        line[lineLength - 1] = '\n';
+        line += lineLength;
+    }
 
-        for (int viewX = -viewWidth/2+1; viewX < viewWidth/2; ++viewX)
-        {
-            const int x = worldX+viewX;
-            const int y = worldY+viewY;
+    memset(line, '#', lineLength - 1);
+    line[lineLength - 1] = '\n';
 
-            if (viewY == 0 && viewX == 0)
-                player << "X"; // Print player
-            
-            else if (x >= 0 && y >= 0 && x < width && y < height && GetPortal(y * width + x).has_value())
-            {
-                // Tile is a portal, render as such
-                player << "?";
-            }
-            else
-            {
-                // Tile is normal, render as such
-                const auto tile = GetTile(x, y);
-                const char buffer[2] =
-                {
-                    TileToChar(tile),
-                    '\0'
-                };
-
-                player << buffer;
-            }
-        }
+    player << std::string_view(map, sizeof(map));
+}
 
-        player << "#\n";
+void World::DrawPinned(Player& player, const char (&view)[VIEW_ROWS][VIEW_COLUMNS]) const
+{
+    const std::string_view shown(&view[0][0], sizeof(view));
+    char border[VIEW_COLUMNS + 2];
+    memset(border, '#', sizeof(border));
+    const std::string_view edge(border, sizeof(border));
+
+    // First time round (on this connection), the top of the screen's cleared and
+    // kept from scrolling, with everything else going on below
+    if (player.shownMap.size() != shown.size())
+    {
+        player << "\x1b[2J\x1b[" << PINNED_MAP_LINES + 1 << "r";
+        player << "\x1b[1;1H" << edge;
+
+        for (int row = 0; row < VIEW_ROWS; ++row)
+            player << "\x1b[" << row + 2 << ";1H#" << std::string_view(view[row], VIEW_COLUMNS) << "#";
+
+        player << "\x1b[" << VIEW_ROWS + 2 << ";1H" << edge;
+        player << "\x1b[" << PINNED_MAP_LINES + 1 << ";1H";
     }
 
-    DrawEdge();
+    // After that, only rows that have changed are drawn again, leaving the cursor
+    // where it was
+    else if (shown != player.shownMap)
+    {
+        player << "\x1b" "7";
+        for (int row = 0; row < VIEW_ROWS; ++row)
+        {
+            const std::string_view line(view[row], VIEW_COLUMNS);
+            if (line != std::string_view(player.shownMap).substr(row * VIEW_COLUMNS, VIEW_COLUMNS))
+                player << "\x1b[" << row + 2 << ";2H" << line;
+        }
+        player << "\x1b" "8";
+    }
+
+    player.shownMap.assign(shown);
 }
 
 void World::Move(Player& player, const Direction direction, const int distance) const
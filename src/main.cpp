@@ -1,90 +1,128 @@
+#include "EventLoop.h"
 #include "Connection.h"
 #include "Common.h"
+#include "Config.h"
 #include "Game.h"
+#include "HotRestart.h"
+#include "Simulation.h"
 
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #define PORT 4000
-#define BACKLOG 128
 
-int main()
+static void PinToCore(std::thread& thread, const unsigned int core)
 {
-    // Create socket
-    int serverFd = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverFd < 0)
-    {
-        perror("Unable to create socket");
-        exit(-1);
-    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) != 0)
+        std::cerr << "Unable to pin shard to core " << core << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    Config::Get().ParseArguments(argc, argv);
+    HotRestart::Prepare(argv);
 
-    // Tell the kernel that, in cases where the socket has been recently used 
-    // (i.e. we just crashed and restarted), we don't care for waiting the 30
-    // or so seconds to make a new one, we're happy to just ditch the old and start afresh.
-    int opt = 1;
-    if (setsockopt(serverFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    Connection::CheckSettings();
+
+    const int port = Config::Get().GetInt("port", PORT);
+    const bool pin = Config::Get().GetInt("pin_shards", 1) != 0;
+    const unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+    int shards = Config::Get().GetInt("shards", 1);
+    if (shards <= 0) shards = cores;
+
+    HotRestart::Handoff handoff;
+    if (HotRestart::IsResuming())
     {
-        perror("Unable to reuse sockets");
-        exit(-1);
+        // Load game whilst the old process is still serving everybody, then take
+        // over its listeners (and with them, its number of shards) and its sessions
+        Game::Get().LoadAreas();
+        if (!HotRestart::Receive(handoff)) exit(-1);
+        shards = handoff.serverFds.size();
     }
 
-#ifdef __APPLE__
-    // Tell the kernel too that any CTRL-C's sent over ought not to disconnect or
-    // close the socket, but rather just raise an error whenever we use it. (In other
-    // words, don't crash the server thread when a user exits).
-    if (setsockopt(serverFd, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt)) < 0)
+    else
     {
-        perror("Unable to use SE_NOSIGPIPE");
-        exit(-1);
+        // Every shard gets a listener of its own on the same port, and since they're all
+        // marked SO_REUSEPORT the kernel spreads incoming connections evenly between them
+        for (int i = 0; i < shards; ++i)
+            handoff.serverFds.emplace_back(EventLoop::Listen(port));
+        handoff.sessions.resize(shards);
+
+        // Load game
+        Game::Get().LoadAreas();
     }
-#endif
 
-    // Bind to port
-    struct sockaddr_in address;
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+    std::cout << "Sludge running on port " << port << " with " << shards << " shard(s)" << std::endl;
 
-    if (bind(serverFd, (struct sockaddr*)&address, sizeof(address)) < 0)
-    {
-        perror("Unable to bind to port");
-        exit(-1);
-    }
+    // The game runs on a thread of its own, with the loops passing commands to it
+    Simulation::Get().Start();
 
-    // Mark the socket as a "passive socket"; i.e we want to listen
-    if (listen(serverFd, BACKLOG) < 0)
+    // Hand each listener over to an event loop of its own, which from there on
+    // accepts and serves all of its clients on its one thread
+    const auto backend = EventLoop::ParseBackend(Config::Get().GetString("backend", "epoll"));
+    std::vector<std::unique_ptr<EventLoop>> loops(shards);
+    std::vector<std::thread> threads;
+
+    const auto RunShards = [&]()
     {
-        perror("Unable to listen with socket");
-        exit(-1);
-    }
+        for (int i = 0; i < shards; ++i)
+        {
+            // Made on the thread that runs it, as io_uring prefers a single submitter
+            threads.emplace_back([&loops, &handoff, i, backend]()
+            {
+                if (!loops[i])
+                {
+                    loops[i] = EventLoop::Create(handoff.serverFds[i], backend);
+                    for (const auto& session : handoff.sessions[i]) loops[i]->Adopt(session);
+                    handoff.sessions[i].clear();
+                }
 
-    std::cout << "Sludge running on port " << PORT << std::endl;
+                loops[i]->Run();
+            });
 
-    // Load game
-    Game::Get().LoadAreas();
+            if (pin) PinToCore(threads.back(), i % cores);
+        }
+    };
 
+    RunShards();
+
+    // Everything else is up to the loops, save for restarts (on SIGUSR2)
     while (1)
     {
-        // Wait until connection
-        sockaddr_in clientAddress;
-        unsigned int clientAddressSize = sizeof(clientAddress);
-        int clientFd = accept(serverFd, (struct sockaddr*)&clientAddress, (socklen_t*)&clientAddressSize);
-       
-        if (clientFd < 0) perror("Unable to accept client connection");
-
-        // Get IP (internally stored per-thread, so copy)
-        std::string address = inet_ntoa(clientAddress.sin_addr);
-        std::cout << "New connection received from " << address << std::endl;
-
-        // Make new connection on new thread
-        std::thread([&]()
+        HotRestart::WaitForRequest();
+        const int channel = HotRestart::Launch();
+        if (channel < 0) continue;
+
+        EventLoop::Stop();
+        for (auto& thread : threads) thread.join();
+        threads.clear();
+
+        // Let every command still waiting run, then keep the game still whilst it's sent
+        Simulation::Get().Pause();
+        for (int i = 0; i < shards; ++i)
+            handoff.sessions[i] = loops[i]->Save();
+
+        // Nothing's closed or torn down on the way out (not even the paused simulation),
+        // as the sockets live on in the new process
+        if (HotRestart::HandOver(channel, handoff))
         {
-            Connection(clientFd, address);
-        }).detach();
+            std::cout << "Handed over to new process" << std::endl;
+            _exit(0);
+        }
+
+        // Otherwise carry on as we were
+        for (int i = 0; i < shards; ++i)
+        {
+            loops[i]->Resume(handoff.sessions[i]);
+            handoff.sessions[i].clear();
+        }
+
+        Simulation::Get().Resume();
+        EventLoop::Continue();
+        RunShards();
     }
-    
-    close(serverFd);
-    return 0;
 }